@@ -1,9 +1,15 @@
 #include <common/bt_error.hpp>
+#include <common/clone.hpp>
 #include <common/fs.hpp>
 #include <common/mmap.hpp>
+#include <common/queue.hpp>
+#include <common/reorder.hpp>
 #include <common/xxhash64.hpp>
+#include <algorithm>
+#include <array>
 #include <charconv>
-#include <iostream>
+#include <mutex>
+#include <thread>
 #include "app.hpp"
 #include "argparse.hpp"
 
@@ -34,6 +40,24 @@ static std::set<std::u8string> parse_list(std::string const& value) {
     return result;
 }
 
+// Unlike parse_list keeps order, case and duplicates.
+static std::vector<std::string> split_list(std::string const& value) {
+    auto result = std::vector<std::string>{};
+    for (std::size_t start = 0; start <= value.size();) {
+        auto const end = std::min(value.find(',', start), value.size());
+        if (end != start) {
+            result.push_back(value.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return result;
+}
+
+// Wrapped since argparse would take a plain vector for list of values
+struct ActionList {
+    std::vector<App::Action> actions;
+};
+
 static std::set<std::uint64_t> parse_hash_list(std::string const& value) {
     auto strings = parse_list(value);
     auto results = std::set<std::uint64_t>{};
@@ -45,6 +69,7 @@ static std::set<std::uint64_t> parse_hash_list(std::string const& value) {
             auto err_ptr = std::from_chars(start, end, result, 16);
             bt_trace(u8"str: {}", str);
             bt_assert(err_ptr.ec == std::errc{} && err_ptr.ptr == end);
+            results.insert(result);
         } else {
             results.insert(XXH64(str));
         }
@@ -52,6 +77,22 @@ static std::set<std::uint64_t> parse_hash_list(std::string const& value) {
     return results;
 }
 
+// Byte count with optional K, M, G or T binary suffix.
+static std::uint64_t parse_size(std::string const& value) {
+    auto result = std::uint64_t{};
+    auto const end = value.data() + value.size();
+    auto const [ptr, ec] = std::from_chars(value.data(), end, result);
+    bt_trace(u8"size: {}", from_std_string(value));
+    bt_assert(ec == std::errc{} && ptr != value.data());
+    if (ptr == end) {
+        return result;
+    }
+    bt_assert(ptr + 1 == end);
+    auto const suffix = std::string_view("KMGT").find(static_cast<char>(std::toupper(*ptr)));
+    bt_assert(suffix != std::string_view::npos);
+    return result << (10 * (suffix + 1));
+}
+
 static std::u8string get_version(std::span<char const> data) noexcept {
     auto databeg = reinterpret_cast<char16_t const*>(data.data());
     auto dataend = databeg + (data.size() / 2);
@@ -126,15 +167,21 @@ void App::parse_args(int argc, char** argv) {
     }
     argparse::ArgumentParser program("bincollector");
     program.add_argument("action")
-            .help("action: " + valid_actions)
+            .help("action: " + valid_actions + "or any of list, checksum and index joined by commas")
             .required()
             .action([](std::string const& value){
-                for (auto const& action: ACTIONS) {
-                    if (action.long_name == value || (action.short_name && action.short_name == value)) {
-                        return action;
+                // Comma separated actions share one traversal
+                auto actions = std::vector<Action>{};
+                for (auto const& name: split_list(value)) {
+                    auto const found = std::find_if(std::begin(ACTIONS), std::end(ACTIONS), [&](Action const& action) {
+                        return action.long_name == name || (action.short_name && action.short_name == name);
+                    });
+                    if (found == std::end(ACTIONS)) {
+                        throw std::runtime_error("Unknown action!");
                     }
+                    actions.push_back(*found);
                 }
-                throw std::runtime_error("Unknown action!");
+                return ActionList { std::move(actions) };
             });
     program.add_argument("manifest")
             .help(".releasemanifest / .manifest / .wad / folder ")
@@ -145,8 +192,33 @@ void App::parse_args(int argc, char** argv) {
     program.add_argument("-r", "--remote")
             .help("Input: remote http mirror to fetch files from(only works for .manifest files).")
             .default_value(std::string{});
+    program.add_argument("--compress-cache")
+            .help("Input: keep chunks compressed in chunk cache (cdn ending in chunks).")
+            .default_value(false)
+            .implicit_value(true);
+    program.add_argument("--cache-quota")
+            .help("Input: byte quota of local cache with K/M/G/T suffix, least recently used data is evicted past it.")
+            .default_value(std::string{"0"});
+    program.add_argument("--since")
+            .help("Input: older .manifest, extract only files changed since it, diff against it or patch output extracted from it.")
+            .default_value(std::string{});
+    program.add_argument("--dedup")
+            .help("Extract: hardlink or reflink files with same content instead of writing them again.")
+            .default_value(std::string{})
+            .action([](std::string const& value) {
+                if (value == "hardlink" || value == "reflink") {
+                    return value;
+                }
+                throw std::runtime_error("Unknown dedup mode!");
+            });
+    program.add_argument("--export")
+            .help("Output: columnar file to write list or checksum rows to instead of printing them.")
+            .default_value(std::string{});
+    program.add_argument("--format")
+            .help("Output: record format, csv, ndjson or binary.")
+            .default_value(std::string{"csv"});
     program.add_argument("-o", "--output")
-            .help("Output directory for extract")
+            .help("Output directory for extract and patch")
             .default_value(std::string{"."});
     program.add_argument("-l", "--lang")
             .help("Filter: language(none for international files).")
@@ -163,14 +235,31 @@ void App::parse_args(int argc, char** argv) {
     program.add_argument("--hashes-exts")
             .help("File: Hash list for extensions")
             .default_value(std::string{});
+    program.add_argument("--wad-index")
+            .help("File: Index of wad tables of content, speeds up repeated runs over game folder.")
+            .default_value(std::string{});
     program.add_argument("--skip-root")
             .help("Skip processing files in root.")
             .default_value(false)
             .implicit_value(true);
+    program.add_argument("--xxh64")
+        .help("Checksum: also compute xxh64 of file data.")
+        .default_value(false)
+        .implicit_value(true);
+    program.add_argument("--unordered")
+        .help("Checksum: print entries as soon as they are hashed instead of in traversal order.")
+        .default_value(false)
+        .implicit_value(true);
     program.add_argument("-w", "--show-wads")
         .help("Show .wad files in dump")
         .default_value(false)
         .implicit_value(true);
+    program.add_argument("-j", "--threads")
+        .help("Number of worker threads, 0 for all cores.")
+        .default_value(int(0))
+        .action([](std::string value) {
+            return std::stoi(value);
+        });
     program.add_argument("-d", "--max-depth")
         .help("Max depth to recurse into.")
         .default_value(int(0))
@@ -179,7 +268,7 @@ void App::parse_args(int argc, char** argv) {
         });
 
     program.parse_args(argc, argv);
-    action = program.get<Action>("action");
+    set_actions(program.get<ActionList>("action").actions);
     manifest = from_std_string(program.get<std::string>("manifest"));
     cdn = from_std_string(program.get<std::string>("cdn"));
     remote = from_std_string(program.get<std::string>("--remote"));
@@ -189,29 +278,117 @@ void App::parse_args(int argc, char** argv) {
     extensions = parse_list(program.get<std::string>("--ext"));
     hash_path_names = from_std_string(program.get<std::string>("--hashes-names"));
     hash_path_extensions = from_std_string(program.get<std::string>("--hashes-exts"));
+    wad_index_path = from_std_string(program.get<std::string>("--wad-index"));
     max_depth = program.get<int>("--max-depth");
+    threads = program.get<int>("--threads");
     show_wads = program.get<bool>("--show-wads");
     skip_root = program.get<bool>("--skip-root");
+    fast_hash = program.get<bool>("--xxh64");
+    unordered = program.get<bool>("--unordered");
+    compress_cache = program.get<bool>("--compress-cache");
+    cache_quota = parse_size(program.get<std::string>("--cache-quota"));
+    since = from_std_string(program.get<std::string>("--since"));
+    dedup = from_std_string(program.get<std::string>("--dedup"));
+    export_path = from_std_string(program.get<std::string>("--export"));
+    out.set_format(OutputSink::parse_format(program.get<std::string>("--format")));
+}
+
+void App::set_actions(std::span<Action const> actions) {
+    bt_assert(!actions.empty() && "No action given!");
+    if (actions.size() == 1) {
+        action = actions.front();
+        return;
+    }
+    action = { &App::fused_manager, "fused", std::nullopt, false, true };
+    for (auto const& fuse: actions) {
+        if (fuse.handler == &App::list_manager) {
+            fused.list = true;
+        } else if (fuse.handler == &App::checksum_manager) {
+            fused.checksum = true;
+        } else if (fuse.handler == &App::index_manager) {
+            fused.index = true;
+        } else {
+            bt_assert(!"Only list, checksum and index can run together!");
+        }
+        action.has_hashes |= fuse.has_hashes;
+        action.remote_ranges &= fuse.remote_ranges;
+    }
 }
 
 void App::run() {
-    auto manager = file::IManager::make(manifest, cdn, remote, langs);
-    return (this->*action.handler)(manager, 1);
+    if (!wad_index_path.empty()) {
+        wad_index.read(wad_index_path);
+    }
+    auto manager = file::IManager::make(manifest, cdn, remote, action.remote_ranges, compress_cache, cache_quota,
+                                        langs);
+    if (!export_path.empty()) {
+        bt_assert((action.handler == &App::list_manager || action.handler == &App::checksum_manager)
+                  && "Export only supports list and checksum!");
+    }
+    (this->*action.handler)(manager, 1);
+    if (!export_path.empty()) {
+        save_export();
+    }
+    if (!wad_index_path.empty()) {
+        wad_index.write(wad_index_path);
+    }
+}
+
+std::size_t App::worker_count() const noexcept {
+    if (threads > 0) {
+        return static_cast<std::size_t>(threads);
+    }
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+std::vector<fs::path> App::find_manifests() const {
+    // Folder stands for every manifest inside of it
+    auto manifests = std::vector<fs::path>{};
+    if (fs::is_directory(fs::path(manifest))) {
+        for (auto const& entry: fs::recursive_directory_iterator(fs::path(manifest))) {
+            if (entry.is_regular_file() && entry.path().extension() == u8".manifest") {
+                manifests.push_back(entry.path());
+            }
+        }
+        std::sort(manifests.begin(), manifests.end());
+    } else {
+        manifests.push_back(fs::path(manifest));
+    }
+    return manifests;
+}
+
+std::shared_ptr<file::ManagerWAD> App::open_wad(std::shared_ptr<file::IFile> entry) {
+    if (wad_index_path.empty()) {
+        return std::make_shared<file::ManagerWAD>(entry);
+    }
+    if (!names.empty() && !wad_index.contains_any(entry, names)) {
+        return nullptr;
+    }
+    return wad_index.open(entry);
+}
+
+std::vector<std::shared_ptr<file::IFile>> App::list_entries(std::shared_ptr<file::IManager> manager) {
+    if (!names.empty()) {
+        if (auto wad = std::dynamic_pointer_cast<file::ManagerWAD>(manager)) {
+            auto const sorted_names = std::vector<std::uint64_t>(names.begin(), names.end());
+            return wad->find_many(sorted_names);
+        }
+    }
+    return manager->list();
 }
 
 void App::list_manager(std::shared_ptr<file::IManager> manager, int depth) {
-    for (auto const& entry: manager->list()) {
+    for (auto const& entry: list_entries(manager)) {
         bt_trace(u8"location: {}", entry->location()->print(u8";"));
         auto hash = entry->find_hash(hashlist);
         if (!names.empty() && !names.contains(hash)) {
             continue;
         }
-        std::shared_ptr<file::IReader> reader = nullptr;
         if (entry->is_wad()) {
             if (!max_depth || depth < max_depth) {
-                reader = entry->open();
-                auto wad = std::make_shared<file::ManagerWAD>(entry);
-                list_manager(wad, depth + 1);
+                if (auto wad = open_wad(entry)) {
+                    list_manager(wad, depth + 1);
+                }
             }
             if (!show_wads) {
                 continue;
@@ -225,25 +402,40 @@ void App::list_manager(std::shared_ptr<file::IManager> manager, int depth) {
             continue;
         }
         auto name = entry->find_name(hashlist);
+        if (!export_path.empty()) {
+            export_row(*entry, hash, ext, name, nullptr);
+            continue;
+        }
         auto id = entry->id();
         auto size = entry->size();
-        fmt_print(std::cout, u8"{:016x},{},{},{},{}\n", hash, ext, name, id, size);
+        out.record({
+            { "hash", OutputSink::Hash { hash } },
+            { "ext", ext },
+            { "name", name },
+            { "id", id },
+            { "size", size },
+        });
     }
 }
 
 void App::extract_manager(std::shared_ptr<file::IManager> manager, int depth) {
-    for (auto const& entry: manager->list()) {
+    if (depth == 1 && !since.empty()) {
+        auto rman = std::dynamic_pointer_cast<file::ManagerRMAN>(manager);
+        bt_assert(rman && "Extract since needs a .manifest source!");
+        rman->keep_changed(rman->diff(fs::path(since)));
+    }
+    auto jobs = std::vector<file::IManager::ExtractJob>{};
+    for (auto const& entry: list_entries(manager)) {
         bt_trace(u8"location: {}", entry->location()->print(u8";"));
         auto hash = entry->find_hash(hashlist);
         if (!names.empty() && !names.contains(hash)) {
             continue;
         }
-        std::shared_ptr<file::IReader> reader = nullptr;
         if (entry->is_wad()) {
             if (!max_depth || depth < max_depth) {
-                reader = entry->open();
-                auto wad = std::make_shared<file::ManagerWAD>(entry);
-                extract_manager(wad, depth + 1);
+                if (auto wad = open_wad(entry)) {
+                    extract_manager(wad, depth + 1);
+                }
             }
             if (!show_wads) {
                 continue;
@@ -265,23 +457,54 @@ void App::extract_manager(std::shared_ptr<file::IManager> manager, int depth) {
         if (out_name.empty() || out_name.size() > 127) {
             out_name = fmt::format(u8"{:016x}{}", hash, ext);
         }
-        entry->extract_to(fs::path(output) / out_name);
+        auto out_path = fs::path(output) / out_name;
+        if (!dedup.empty() && entry->size() != 0) {
+            if (auto content_id = entry->content_id(); !content_id.empty()) {
+                auto [i, inserted] = extracted.try_emplace(std::move(content_id), out_path);
+                if (!inserted) {
+                    if (i->second != out_path) {
+                        duplicates.emplace_back(i->second, std::move(out_path));
+                    }
+                    continue;
+                }
+            }
+        }
+        jobs.push_back({ entry, std::move(out_path) });
+    }
+    manager->extract(jobs, worker_count());
+    // Nested wads may link to files of outer levels, those are only written once outermost extract is done
+    if (depth == 1) {
+        for (auto const& [src, dst]: duplicates) {
+            link_duplicate(src, dst);
+        }
+        duplicates.clear();
+    }
+}
+
+void App::link_duplicate(fs::path const& src, fs::path const& dst) {
+    bt_trace(u8"file_path: {}", dst.generic_u8string());
+    bt_rethrow(fs::create_directories(dst.parent_path()));
+    // Output of earlier run would make link fail
+    bt_rethrow(fs::remove(dst));
+    auto const error = dedup == u8"hardlink" ? hardlink_file(src, dst) : reflink_file(src, dst);
+    if (error) {
+        // Filesystem can not share data here, plain copy still skips fetching and decoding
+        bt_rethrow(fs::copy_file(src, dst));
     }
 }
 
 void App::index_manager(std::shared_ptr<file::IManager> manager, int depth) {
-    for (auto const& entry: manager->list()) {
+    for (auto const& entry: list_entries(manager)) {
         bt_trace(u8"location: {}", entry->location()->print(u8";"));
         auto hash = entry->find_hash(hashlist);
         if (!names.empty() && !names.contains(hash)) {
             continue;
         }
-        std::shared_ptr<file::IReader> reader = nullptr;
         if (entry->is_wad()) {
             if (!max_depth || depth < max_depth) {
-                reader = entry->open();
-                auto wad = std::make_shared<file::ManagerWAD>(entry);
-                index_manager(wad, depth + 1);
+                if (auto wad = open_wad(entry)) {
+                    index_manager(wad, depth + 1);
+                }
             }
             if (!show_wads) {
                 continue;
@@ -301,16 +524,44 @@ void App::index_manager(std::shared_ptr<file::IManager> manager, int depth) {
         auto name = entry->find_name(hashlist);
         auto id = entry->id();
         auto size = entry->size();
-        fmt_print(std::cout, u8"{:016x},{},{},{},{}\n", hash, ext, name, id, size);
-        auto out_name = fs::path(output) / id;
-        if (!fs::exists(out_name)) {
-            entry->extract_to(fs::path(output) / id);
+        out.record({
+            { "hash", OutputSink::Hash { hash } },
+            { "ext", ext },
+            { "name", name },
+            { "id", id },
+            { "size", size },
+        });
+        if (auto target = index_target(*entry)) {
+            index_write(*entry, *target);
+        }
+    }
+}
+
+std::optional<App::IndexTarget> App::index_target(file::IFile& entry) {
+    auto target = IndexTarget { fs::path(output) / entry.id(), {} };
+    // Aliases of one payload may have different ids, only first of them is decoded
+    if (auto content_id = entry.content_id(); !content_id.empty()) {
+        auto [i, inserted] = extracted.try_emplace(std::move(content_id), target.path);
+        if (!inserted && i->second != target.path) {
+            target.source = i->second;
         }
     }
+    if (fs::exists(target.path)) {
+        return std::nullopt;
+    }
+    return target;
+}
+
+void App::index_write(file::IFile& entry, IndexTarget const& target) {
+    if (!target.source.empty()) {
+        link_duplicate(target.source, target.path);
+    } else if (!fs::exists(target.path)) {
+        entry.extract_to(target.path);
+    }
 }
 
 void App::exe_ver(std::shared_ptr<file::IManager> manager, int depth) {
-    for (auto const& entry: manager->list()) {
+    for (auto const& entry: list_entries(manager)) {
         bt_trace(u8"location: {}", entry->location()->print(u8";"));
         auto ext = entry->find_extension(hashlist);
         if (ext != u8".exe") {
@@ -324,24 +575,237 @@ void App::exe_ver(std::shared_ptr<file::IManager> manager, int depth) {
         auto reader = entry->open();
         auto data = reader->read();
         auto version = get_version(data);
-        fmt_print(std::cout, u8"{},{}\n", name, version);
+        out.record({ { "name", name }, { "version", version } });
     }
 }
 
+// Batches are read on traversing thread, digested by workers and printed in traversal order unless unordered.
+// Fused actions share each batch, so every entry is decoded once for listing, digesting and indexing alike.
+struct App::EntryPipeline {
+    struct Row {
+        std::shared_ptr<file::IFile> entry;
+        std::uint64_t hash;
+        std::u8string ext;
+        std::u8string name;
+        bool link;
+    };
+    struct Task {
+        std::size_t sequence;
+        std::vector<Row> rows;
+        file::ChecksumBatch batch;
+    };
+    // Batches hold up to 32MB of file data each, this many of them may be read and not yet printed
+    static constexpr std::size_t const WINDOW_LIMIT = 16;
+
+    App& app;
+    Fused actions;
+    bool tagged;
+    ReorderBuffer<Task> reorder;
+    BoundedQueue<Task> tasks;
+    std::vector<std::thread> workers;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    bt::error_stack_t error_stack;
+
+    EntryPipeline(App& app, std::size_t threads, Fused actions, bool tagged)
+        : app(app)
+        , actions(actions)
+        , tagged(tagged)
+        , reorder(std::clamp(threads * 2, std::size_t{2}, WINDOW_LIMIT), !app.unordered)
+        , tasks(WINDOW_LIMIT)
+    {
+        for (std::size_t i = 0; i != threads; ++i) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~EntryPipeline() {
+        tasks.close();
+        for (auto& worker: workers) {
+            worker.join();
+        }
+    }
+
+    void submit(std::vector<Row> rows) {
+        if (rows.empty()) {
+            return;
+        }
+        auto const sequence = reorder.reserve();
+        if (!sequence) {
+            rethrow();
+        }
+        auto targets = std::vector<std::optional<IndexTarget>>{};
+        if (actions.index) {
+            targets.reserve(rows.size());
+            for (auto const& row: rows) {
+                targets.push_back(row.link ? std::nullopt : app.index_target(*row.entry));
+            }
+        }
+        auto batch = file::ChecksumBatch{};
+        if (actions.checksum) {
+            auto files = std::vector<std::shared_ptr<file::IFile>>{};
+            auto outputs = std::vector<fs::path>{};
+            files.reserve(rows.size());
+            for (std::size_t i = 0; i != rows.size(); ++i) {
+                files.push_back(rows[i].entry);
+                if (actions.index) {
+                    // Files batch does not hold are written out while they are digested
+                    auto const& target = targets[i];
+                    outputs.push_back(target && target->source.empty() ? target->path : fs::path{});
+                }
+            }
+            batch = file::ChecksumBatch::read(files, app.fast_hash, outputs);
+        }
+        if (actions.index) {
+            // Batch still holds readers of the rest, so extracting takes data already decoded for digest
+            for (std::size_t i = 0; i != rows.size(); ++i) {
+                if (targets[i]) {
+                    app.index_write(*rows[i].entry, *targets[i]);
+                }
+            }
+        }
+        if (!tasks.push({ *sequence, std::move(rows), std::move(batch) })) {
+            rethrow();
+        }
+    }
+
+    void finish() {
+        tasks.close();
+        for (auto& worker: workers) {
+            worker.join();
+        }
+        workers.clear();
+        rethrow();
+    }
+
+private:
+    void work() {
+        while (auto task = tasks.pop()) {
+            try {
+                task->batch.digest();
+                auto const sequence = task->sequence;
+                reorder.finish(sequence, std::move(*task), [this](Task& done) { emit(done); });
+            } catch (std::exception const&) {
+                fail();
+            }
+        }
+    }
+
+    void emit(Task& task) {
+        for (std::size_t i = 0; i != task.rows.size(); ++i) {
+            auto const& [entry, hash, ext, name, link] = task.rows[i];
+            if (!app.export_path.empty()) {
+                app.export_row(*entry, hash, ext, name, &task.batch.results[i]);
+                continue;
+            }
+            auto const listed = actions.list || (actions.index && !link);
+            auto id = listed ? entry->id() : std::u8string{};
+            auto size = listed ? entry->size() : std::size_t{};
+            if (actions.list) {
+                print(u8"list", {
+                    { "hash", OutputSink::Hash { hash } },
+                    { "ext", ext },
+                    { "name", name },
+                    { "id", id },
+                    { "size", size },
+                });
+            }
+            if (actions.checksum) {
+                auto checksums = task.batch.results[i].print();
+                auto location = entry->location()->print(u8";");
+                auto file = fmt::format(u8"{:016x}{}", hash, ext);
+                print(u8"checksum", {
+                    { "checksums", checksums },
+                    { "file", file },
+                    { "name", name },
+                    { "location", location },
+                });
+            }
+            if (actions.index && !link) {
+                print(u8"index", {
+                    { "hash", OutputSink::Hash { hash } },
+                    { "ext", ext },
+                    { "name", name },
+                    { "id", id },
+                    { "size", size },
+                });
+            }
+        }
+    }
+
+    // Fused rows lead with name of action that printed them
+    void print(std::u8string_view action, std::initializer_list<OutputSink::Field> fields) {
+        if (!tagged) {
+            app.out.record(fields);
+            return;
+        }
+        auto tagged_fields = std::array<OutputSink::Field, 8>{};
+        bt_assert(fields.size() < tagged_fields.size());
+        tagged_fields[0] = { "action", action };
+        std::copy(fields.begin(), fields.end(), tagged_fields.begin() + 1);
+        app.out.record(std::span<OutputSink::Field const> { tagged_fields.data(), fields.size() + 1 });
+    }
+
+    // First error wins, its trace is carried over to traversing thread
+    void fail() {
+        {
+            auto const lock = std::lock_guard(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+                error_stack = std::move(bt::error_stack());
+            }
+            bt::error_stack().clear();
+        }
+        tasks.close();
+        reorder.close();
+    }
+
+    void rethrow() {
+        auto const lock = std::lock_guard(error_mutex);
+        if (error) {
+            auto& stack = bt::error_stack();
+            stack.insert(stack.end(), error_stack.begin(), error_stack.end());
+            std::rethrow_exception(error);
+        }
+    }
+};
+
 void App::checksum_manager(std::shared_ptr<file::IManager> manager, int depth) {
-    for (auto const& entry: manager->list()) {
+    auto pipeline = EntryPipeline(*this, worker_count(), { .checksum = true }, false);
+    pipeline_entries(manager, depth, pipeline);
+    pipeline.finish();
+}
+
+void App::fused_manager(std::shared_ptr<file::IManager> manager, int depth) {
+    auto pipeline = EntryPipeline(*this, worker_count(), fused, true);
+    pipeline_entries(manager, depth, pipeline);
+    pipeline.finish();
+}
+
+void App::pipeline_entries(std::shared_ptr<file::IManager> manager, int depth, EntryPipeline& pipeline) {
+    // Entries are read in batches, batch is submitted before nested wads so sequence follows traversal
+    constexpr std::size_t const BATCH_COUNT = 256;
+    constexpr std::size_t const BATCH_SIZE = 32 * 1024 * 1024;
+    auto batch = std::vector<EntryPipeline::Row>{};
+    auto batch_size = std::size_t{};
+    auto const flush = [&] {
+        pipeline.submit(std::move(batch));
+        batch.clear();
+        batch_size = 0;
+    };
+    for (auto const& entry: list_entries(manager)) {
         auto location = entry->location()->print(u8";");
         bt_trace(u8"location: {}", location);
         auto hash = entry->find_hash(hashlist);
         if (!names.empty() && !names.contains(hash)) {
             continue;
         }
-        std::shared_ptr<file::IReader> reader = nullptr;
         if (entry->is_wad()) {
             if (!max_depth || depth < max_depth) {
-                reader = entry->open();
-                auto wad = std::make_shared<file::ManagerWAD>(entry);
-                checksum_manager(wad, depth + 1);
+                if (auto wad = open_wad(entry)) {
+                    flush();
+                    pipeline_entries(wad, depth + 1, pipeline);
+                }
             }
             if (!show_wads) {
                 continue;
@@ -354,10 +818,155 @@ void App::checksum_manager(std::shared_ptr<file::IManager> manager, int depth) {
         if (!extensions.empty() && !extensions.contains(ext)) {
             continue;
         }
-        auto checksums = entry->checksums().print();
+        // Index alone has nothing to do with links
+        auto link = !entry->get_link().empty();
+        if (link && !pipeline.actions.list && !pipeline.actions.checksum) {
+            continue;
+        }
         auto name = entry->find_name(hashlist);
-        fmt_print(std::cout,
-                  u8"{},{:016x}{},{},{}\n",
-                  checksums, hash, ext, name, location);
+        batch_size += entry->size();
+        batch.push_back({ entry, hash, std::move(ext), std::move(name), link });
+        if (batch.size() == BATCH_COUNT || batch_size >= BATCH_SIZE) {
+            flush();
+        }
+    }
+    flush();
+}
+
+void App::verify_manager(std::shared_ptr<file::IManager> manager, [[maybe_unused]] int depth) {
+    auto rman = std::dynamic_pointer_cast<file::ManagerRMAN>(manager);
+    bt_assert(rman && "Verify needs a .manifest source!");
+    auto const errors = rman->verify(worker_count());
+    for (auto const& error: errors) {
+        auto bundle = fmt::format(u8"{:016X}.bundle", error.bundle_id);
+        auto chunk = fmt::format(u8"{:016X}", error.chunk_id);
+        out.record({ { "bundle", bundle }, { "chunk", chunk }, { "error", error.error } });
+    }
+    bt_assert(errors.empty());
+}
+
+void App::mirror_manager([[maybe_unused]] std::shared_ptr<file::IManager> manager, [[maybe_unused]] int depth) {
+    bt_assert(!cdn.empty() && "Mirror needs cdn to store bundles in!");
+    auto const manifests = find_manifests();
+    bt_assert(!manifests.empty());
+    auto const result = file::ManagerRMAN::mirror(manifests, cdn, remote, compress_cache, cache_quota,
+                                                  worker_count());
+    for (auto const& error: result.errors) {
+        auto bundle = fmt::format(u8"{:016X}.bundle", error.bundle_id);
+        out.record({ { "bundle", bundle }, { "error", error.error } });
+    }
+    out.record({ { "kind", u8"planned" }, { "count", result.bundles_planned }, { "bytes", result.bytes_planned } });
+    out.record({ { "kind", u8"skipped" }, { "count", result.bundles_skipped }, { "bytes", result.bytes_skipped } });
+    out.record({ { "kind", u8"fetched" }, { "count", result.bundles_fetched }, { "bytes", result.bytes_fetched } });
+    bt_assert(result.errors.empty());
+}
+
+void App::gc_manager([[maybe_unused]] std::shared_ptr<file::IManager> manager, [[maybe_unused]] int depth) {
+    bt_assert(!cdn.empty() && "Garbage collection needs cdn to clean!");
+    auto const manifests = find_manifests();
+    bt_assert(!manifests.empty());
+    auto const result = file::ManagerRMAN::collect(manifests, cdn, cache_quota, worker_count());
+    out.record({ { "kind", u8"removed" }, { "count", result.removed }, { "bytes", result.bytes_removed } });
+    out.record({ { "kind", u8"kept" }, { "count", result.kept }, { "bytes", result.bytes_kept } });
+}
+
+void App::diff_manager(std::shared_ptr<file::IManager> manager, [[maybe_unused]] int depth) {
+    auto rman = std::dynamic_pointer_cast<file::ManagerRMAN>(manager);
+    bt_assert(rman && "Diff needs a .manifest source!");
+    bt_assert(!since.empty() && "Diff needs older manifest in --since!");
+    auto const diff = rman->diff(fs::path(since));
+    for (auto const& entry: diff.entries) {
+        auto const name = rman::ManifestDiff::name(entry.change);
+        auto const& file = entry.new_index != rman::ManifestDiff::npos ? diff.new_files[entry.new_index]
+                                                                        : diff.old_files[entry.old_index];
+        auto const& old_path = entry.change == rman::ManifestDiff::Change::Renamed
+            ? diff.old_files[entry.old_index].path : std::u8string{};
+        out.record({
+            { "change", name },
+            { "path", file.path },
+            { "old_path", old_path },
+            { "size", file.size },
+        });
+    }
+    auto chunk_bytes = std::uint64_t{};
+    auto bundle_bytes = std::vector<std::uint64_t>(diff.new_bundles.size());
+    for (std::size_t index = 0; auto const& chunk: diff.new_chunks) {
+        auto id = fmt::format(u8"{:016X}", chunk.id);
+        auto bundle = fmt::format(u8"{:016X}.bundle", chunk.bundle_id);
+        out.record({ { "kind", u8"chunk" }, { "id", id }, { "bundle", bundle }, { "bytes", chunk.compressed_size } });
+        chunk_bytes += chunk.compressed_size;
+        if (diff.new_bundles[index] != chunk.bundle_id) {
+            ++index;
+        }
+        bundle_bytes[index] += chunk.compressed_size;
+    }
+    auto bundles_bytes = std::uint64_t{};
+    for (std::size_t index = 0; index != diff.new_bundles.size(); ++index) {
+        auto bundle = fmt::format(u8"{:016X}.bundle", diff.new_bundles[index]);
+        out.record({ { "kind", u8"bundle" }, { "bundle", bundle }, { "bytes", bundle_bytes[index] } });
+        bundles_bytes += bundle_bytes[index];
+    }
+    out.record({ { "kind", u8"chunks" }, { "count", diff.new_chunks.size() }, { "bytes", chunk_bytes } });
+    out.record({ { "kind", u8"bundles" }, { "count", diff.new_bundles.size() }, { "bytes", bundles_bytes } });
+}
+
+void App::patch_manager(std::shared_ptr<file::IManager> manager, [[maybe_unused]] int depth) {
+    auto rman = std::dynamic_pointer_cast<file::ManagerRMAN>(manager);
+    bt_assert(rman && "Patch needs a .manifest source!");
+    bt_assert(!since.empty() && "Patch needs older manifest in --since!");
+    bt_assert(!output.empty() && "Patch needs tree extracted from older manifest in --output!");
+    auto const result = rman->patch(rman->diff(fs::path(since)), fs::path(output));
+    out.record({ { "kind", u8"added" }, { "count", result.added } });
+    out.record({ { "kind", u8"removed" }, { "count", result.removed } });
+    out.record({ { "kind", u8"renamed" }, { "count", result.renamed } });
+    out.record({ { "kind", u8"modified" }, { "count", result.modified } });
+    out.record({ { "kind", u8"untrusted" }, { "count", result.untrusted } });
+    out.record({ { "kind", u8"kept" }, { "bytes", result.bytes_kept } });
+    out.record({ { "kind", u8"moved" }, { "bytes", result.bytes_moved } });
+    out.record({ { "kind", u8"written" }, { "bytes", result.bytes_written } });
+}
+
+void App::export_row(file::IFile& entry, std::uint64_t hash, std::u8string_view ext, std::u8string_view name,
+                     file::Checksums const* checksums) {
+    // Digests are stored raw, files without one (links) get zeros
+    auto const append_digest = [&](std::vector<unsigned char>& out, std::u8string const& key, std::size_t size) {
+        auto const offset = out.size();
+        out.resize(offset + size);
+        auto const i = checksums->list.find(key);
+        if (i == checksums->list.end() || i->second.size() != size * 2) {
+            return;
+        }
+        for (std::size_t index = 0; index != size; ++index) {
+            auto const hex = std::string_view(i->second).substr(index * 2, 2);
+            std::from_chars(hex.data(), hex.data() + 2, out[offset + index], 16);
+        }
+    };
+    auto& table = exported;
+    table.hashes.push_back(hash);
+    table.exts.push_back(table.ext_dict.intern(ext));
+    table.names.push(name);
+    table.ids.push(entry.id());
+    table.sizes.push_back(entry.size());
+    table.locations.push_back(table.location_dict.intern(entry.location()->print(u8";")));
+    if (checksums) {
+        table.has_checksums = true;
+        append_digest(table.md5, u8"md5", 16);
+        append_digest(table.sha1, u8"sha1", 20);
+    }
+}
+
+void App::save_export() {
+    auto const& table = exported;
+    auto writer = columnar::Writer(table.hashes.size());
+    writer.add("hash", table.hashes);
+    writer.add("ext", table.ext_dict, table.exts);
+    writer.add("name", table.names);
+    writer.add("id", table.ids);
+    writer.add("size", table.sizes);
+    writer.add("location", table.location_dict, table.locations);
+    if (table.has_checksums) {
+        writer.add("md5", 16, table.md5);
+        writer.add("sha1", 20, table.sha1);
     }
+    writer.save(fs::path(export_path));
 }
@@ -1,9 +1,14 @@
 #pragma once
+#include <common/columnar.hpp>
+#include <common/output.hpp>
 #include <file/hashlist.hpp>
 #include <file/rlsm.hpp>
 #include <file/rman.hpp>
 #include <file/wad.hpp>
+#include <file/wadindex.hpp>
 #include <set>
+#include <span>
+#include <unordered_map>
 
 struct App {
     struct Action {
@@ -11,12 +16,22 @@ struct App {
         std::string_view long_name;
         std::optional<std::string_view> short_name = std::nullopt;
         bool has_hashes = true;
+        bool remote_ranges = false;
+    };
+
+    // Actions run together by fused_manager, rows of each entry are printed in this order
+    struct Fused {
+        bool list = {};
+        bool checksum = {};
+        bool index = {};
     };
 
     App(fs::path src_dir);
     fs::path src_dir;
     file::HashList hashlist = {};
+    file::WadIndex wad_index = {};
     Action action = {};
+    Fused fused = {};
     std::u8string manifest = {};
     std::u8string cdn = {};
     std::u8string output = {};
@@ -26,26 +41,86 @@ struct App {
     std::set<std::uint64_t> names = {};
     std::u8string hash_path_names = {};
     std::u8string hash_path_extensions = {};
+    std::u8string wad_index_path = {};
     int max_depth = {};
+    int threads = {};
     bool show_wads = {};
     bool skip_root = {};
+    bool fast_hash = {};
+    bool unordered = {};
+    bool compress_cache = {};
+    std::uint64_t cache_quota = {};
+    std::u8string since = {};
+    std::u8string dedup = {};
+    std::u8string export_path = {};
+    OutputSink out = {};
 
     void parse_args(int argc, char** argv);
     void load_hashes();
     void run();
     void save_hashes();
 private:
+    // Rows of list or checksum kept for --export instead of printing them
+    struct ExportTable {
+        std::vector<std::uint64_t> hashes;
+        std::vector<std::uint32_t> exts;
+        columnar::StringsBuilder names;
+        columnar::StringsBuilder ids;
+        std::vector<std::uint64_t> sizes;
+        std::vector<std::uint32_t> locations;
+        std::vector<unsigned char> md5;
+        std::vector<unsigned char> sha1;
+        columnar::DictionaryBuilder ext_dict;
+        columnar::DictionaryBuilder location_dict;
+        bool has_checksums = {};
+    };
+    ExportTable exported = {};
+
+    // Content id of every file extracted or indexed so far mapped to its path, and copies to link once all are written
+    std::unordered_map<std::u8string, fs::path> extracted = {};
+    std::vector<std::pair<fs::path, fs::path>> duplicates = {};
+
+    // Index output of entry, source is set when same content was indexed under another path before
+    struct IndexTarget {
+        fs::path path;
+        fs::path source;
+    };
+
+    std::size_t worker_count() const noexcept;
+    std::vector<fs::path> find_manifests() const;
+    std::shared_ptr<file::ManagerWAD> open_wad(std::shared_ptr<file::IFile> entry);
+    std::vector<std::shared_ptr<file::IFile>> list_entries(std::shared_ptr<file::IManager> manager);
+    void set_actions(std::span<Action const> actions);
     void checksum_manager(std::shared_ptr<file::IManager> manager, int depth);
+    void fused_manager(std::shared_ptr<file::IManager> manager, int depth);
+    struct EntryPipeline;
+    void pipeline_entries(std::shared_ptr<file::IManager> manager, int depth, EntryPipeline& pipeline);
     void list_manager(std::shared_ptr<file::IManager> manager, int depth);
     void extract_manager(std::shared_ptr<file::IManager> manager, int depth);
+    void link_duplicate(fs::path const& src, fs::path const& dst);
+    void export_row(file::IFile& entry, std::uint64_t hash, std::u8string_view ext, std::u8string_view name,
+                    file::Checksums const* checksums);
+    void save_export();
     void index_manager(std::shared_ptr<file::IManager> manager, int depth);
+    std::optional<IndexTarget> index_target(file::IFile& entry);
+    void index_write(file::IFile& entry, IndexTarget const& target);
     void exe_ver(std::shared_ptr<file::IManager> manager, int depth);
+    void verify_manager(std::shared_ptr<file::IManager> manager, int depth);
+    void mirror_manager(std::shared_ptr<file::IManager> manager, int depth);
+    void gc_manager(std::shared_ptr<file::IManager> manager, int depth);
+    void diff_manager(std::shared_ptr<file::IManager> manager, int depth);
+    void patch_manager(std::shared_ptr<file::IManager> manager, int depth);
 
     static inline constexpr Action ACTIONS[] = {
-        { &App::list_manager, "list", "ls", true },
-        { &App::extract_manager, "extract", "ex", true },
-        { &App::index_manager, "index", std::nullopt, true },
-        { &App::exe_ver, "exever", std::nullopt, false },
-        { &App::checksum_manager, "checksum", std::nullopt, true },
+        { &App::list_manager, "list", "ls", true, true },
+        { &App::extract_manager, "extract", "ex", true, false },
+        { &App::index_manager, "index", std::nullopt, true, false },
+        { &App::exe_ver, "exever", std::nullopt, false, false },
+        { &App::checksum_manager, "checksum", std::nullopt, true, false },
+        { &App::verify_manager, "verify", std::nullopt, false, false },
+        { &App::mirror_manager, "mirror", std::nullopt, false, false },
+        { &App::gc_manager, "gc", std::nullopt, false, false },
+        { &App::diff_manager, "diff", std::nullopt, false, false },
+        { &App::patch_manager, "patch", std::nullopt, false, false },
     };
 };
@@ -0,0 +1,33 @@
+#include <common/binfile.hpp>
+#include <common/bt_error.hpp>
+#include <common/mmap.hpp>
+#include <random>
+
+// Several processes may publish same file at once, each needs its own staging file
+static fs::path unique_tmp_path(fs::path path) {
+    thread_local auto random = std::mt19937_64(std::random_device{}());
+    path += fmt::format(u8".{:016x}.tmp", random());
+    return path;
+}
+
+void BinWriter::save(fs::path const& path) const {
+    bt_trace(u8"path: {}", path.generic_u8string());
+    if (path.has_parent_path()) {
+        bt_rethrow(fs::create_directories(path.parent_path()));
+    }
+    auto const tmp_path = unique_tmp_path(path);
+    {
+        auto out = MMap<char>{};
+        bt_rethrow(out.create(tmp_path, data.size()).unwrap());
+        if (!data.empty()) {
+            std::memcpy(out.data(), data.data(), data.size());
+        }
+    }
+    try {
+        bt_rethrow(fs::rename(tmp_path, path));
+    } catch (std::exception const&) {
+        auto error = std::error_code{};
+        fs::remove(tmp_path, error);
+        throw;
+    }
+}
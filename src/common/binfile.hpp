@@ -0,0 +1,77 @@
+#pragma once
+#include <common/fs.hpp>
+#include <array>
+#include <cinttypes>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+struct BinReader {
+    std::span<char const> data = {};
+
+    template<typename T> requires(std::is_trivially_copyable_v<T>)
+    [[nodiscard]] inline bool read(T& value) noexcept {
+        if (data.size() < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data.data(), sizeof(T));
+        data = data.subspan(sizeof(T));
+        return true;
+    }
+
+    template<typename T> requires(std::is_trivially_copyable_v<T>)
+    [[nodiscard]] inline bool read(std::vector<T>& values) {
+        auto count = std::uint32_t{};
+        if (!read(count) || data.size() / sizeof(T) < count) {
+            return false;
+        }
+        values.resize(count);
+        std::memcpy(values.data(), data.data(), sizeof(T) * count);
+        data = data.subspan(sizeof(T) * count);
+        return true;
+    }
+
+    [[nodiscard]] inline bool read(std::u8string& value) {
+        auto size = std::uint32_t{};
+        if (!read(size) || data.size() < size) {
+            return false;
+        }
+        value.assign(reinterpret_cast<char8_t const*>(data.data()), size);
+        data = data.subspan(size);
+        return true;
+    }
+};
+
+struct BinWriter {
+    std::vector<char> data = {};
+
+    template<typename T> requires(std::is_trivially_copyable_v<T>)
+    inline void write(T const& value) {
+        write_raw(&value, sizeof(T));
+    }
+
+    template<typename T> requires(std::is_trivially_copyable_v<T>)
+    inline void write(std::vector<T> const& values) {
+        write(static_cast<std::uint32_t>(values.size()));
+        write_raw(values.data(), sizeof(T) * values.size());
+    }
+
+    inline void write(std::u8string_view value) {
+        write(static_cast<std::uint32_t>(value.size()));
+        write_raw(value.data(), value.size());
+    }
+
+    inline void write_raw(void const* src, std::size_t size) {
+        if (size) {
+            auto const offset = data.size();
+            data.resize(offset + size);
+            std::memcpy(data.data() + offset, src, size);
+        }
+    }
+
+    // Writes to temporary file first so readers never observe partial file.
+    void save(fs::path const& path) const;
+};
@@ -0,0 +1,68 @@
+#include "clone.hpp"
+#include <errno.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+#ifdef __APPLE__
+#include <sys/clonefile.h>
+#endif
+
+auto hardlink_file(std::filesystem::path const& src, std::filesystem::path const& dst) noexcept -> MMapError {
+#ifdef _WIN32
+    if (::CreateHardLink(dst.string().c_str(), src.string().c_str(), nullptr) == FALSE) {
+        return MMapError::with_header("create hard link");
+    }
+#else
+    if (::link(src.string().c_str(), dst.string().c_str()) != 0) {
+        return MMapError::with_header("create hard link");
+    }
+#endif
+    return {};
+}
+
+auto reflink_file(std::filesystem::path const& src, std::filesystem::path const& dst) noexcept -> MMapError {
+#if defined(__linux__) && defined(FICLONE)
+    auto const src_handle = ::open(src.string().c_str(), O_RDONLY);
+    if (src_handle == -1) {
+        return MMapError::with_header("open source file");
+    }
+    struct ::stat raw_stat = {};
+    if (::fstat(src_handle, &raw_stat) != 0) {
+        auto error = MMapError::with_header("get file mode");
+        ::close(src_handle);
+        return error;
+    }
+    auto const dst_handle = ::open(dst.string().c_str(), O_WRONLY | O_CREAT | O_EXCL, raw_stat.st_mode & 0777);
+    if (dst_handle == -1) {
+        auto error = MMapError::with_header("create file");
+        ::close(src_handle);
+        return error;
+    }
+    auto error = MMapError{};
+    if (::ioctl(dst_handle, FICLONE, src_handle) != 0) {
+        error = MMapError::with_header("clone file");
+    }
+    ::close(dst_handle);
+    ::close(src_handle);
+    if (error) {
+        ::unlink(dst.string().c_str());
+    }
+    return error;
+#elif defined(__APPLE__)
+    if (::clonefile(src.string().c_str(), dst.string().c_str(), 0) != 0) {
+        return MMapError::with_header("clone file");
+    }
+    return {};
+#else
+    return { "clone file", ENOTSUP };
+#endif
+}
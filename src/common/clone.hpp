@@ -0,0 +1,11 @@
+#pragma once
+#include <common/mmap.hpp>
+#include <filesystem>
+
+// New dst names same inode as src, writes through either path show up in both.
+[[nodiscard]] auto hardlink_file(std::filesystem::path const& src, std::filesystem::path const& dst) noexcept
+    -> MMapError;
+
+// New dst shares extents of src copy on write, only filesystems with block cloning support this.
+[[nodiscard]] auto reflink_file(std::filesystem::path const& src, std::filesystem::path const& dst) noexcept
+    -> MMapError;
@@ -0,0 +1,88 @@
+#include <common/binfile.hpp>
+#include <common/bt_error.hpp>
+#include <common/columnar.hpp>
+
+using namespace columnar;
+
+template <typename T>
+static std::span<char const> as_chars(T const& values) noexcept {
+    return { reinterpret_cast<char const*>(std::data(values)), std::size(values) * sizeof(*std::data(values)) };
+}
+
+std::uint64_t StringsBuilder::push(std::u8string_view value) {
+    bytes.insert(bytes.end(), value.begin(), value.end());
+    offsets.push_back(bytes.size());
+    return offsets.size() - 2;
+}
+
+std::uint32_t DictionaryBuilder::intern(std::u8string_view value) {
+    auto const [i, inserted] = indexes.try_emplace(std::u8string(value), static_cast<std::uint32_t>(indexes.size()));
+    if (inserted) {
+        strings.push(value);
+    }
+    return i->second;
+}
+
+void Writer::add(std::string_view name, std::span<std::uint32_t const> values) {
+    bt_assert(values.size() == rows_);
+    add(name, Type::U32, sizeof(std::uint32_t), values.size(), as_chars(values));
+}
+
+void Writer::add(std::string_view name, std::span<std::uint64_t const> values) {
+    bt_assert(values.size() == rows_);
+    add(name, Type::U64, sizeof(std::uint64_t), values.size(), as_chars(values));
+}
+
+void Writer::add(std::string_view name, std::uint32_t width, std::span<unsigned char const> values) {
+    bt_assert(width && values.size() == rows_ * width);
+    add(name, Type::Fixed, width, rows_, as_chars(values));
+}
+
+void Writer::add(std::string_view name, StringsBuilder const& values) {
+    bt_assert(values.offsets.size() == rows_ + 1);
+    add(name, Type::String, 0, rows_, as_chars(values.offsets), as_chars(values.bytes));
+}
+
+void Writer::add(std::string_view name, DictionaryBuilder const& values, std::span<std::uint32_t const> indexes) {
+    add(name, indexes);
+    auto const& strings = values.strings;
+    add(std::string(name) + ".dict", Type::String, 0, strings.offsets.size() - 1,
+        as_chars(strings.offsets), as_chars(strings.bytes));
+}
+
+void Writer::add(std::string_view name, Type type, std::uint32_t width, std::uint64_t count,
+                 std::span<char const> head, std::span<char const> tail) {
+    auto column = Column{};
+    bt_assert(name.size() <= column.header.name.size());
+    std::memcpy(column.header.name.data(), name.data(), name.size());
+    column.header.type = type;
+    column.header.width = width;
+    column.header.count = count;
+    column.header.size = head.size() + tail.size();
+    column.data.reserve(column.header.size);
+    column.data.insert(column.data.end(), head.begin(), head.end());
+    column.data.insert(column.data.end(), tail.begin(), tail.end());
+    columns_.push_back(std::move(column));
+}
+
+void Writer::save(std::filesystem::path const& path) const {
+    bt_trace(u8"path: {}", path.generic_u8string());
+    auto const align = [](std::uint64_t offset) { return (offset + 7) & ~std::uint64_t{7}; };
+    auto headers = std::vector<ColumnHeader>{};
+    auto offset = std::uint64_t{ sizeof(FileHeader) + sizeof(ColumnHeader) * columns_.size() };
+    for (auto const& column: columns_) {
+        offset = align(offset);
+        auto& header = headers.emplace_back(column.header);
+        header.offset = offset;
+        offset += header.size;
+    }
+    auto writer = BinWriter{};
+    writer.data.reserve(offset);
+    writer.write(FileHeader { MAGIC, VERSION, rows_, static_cast<std::uint32_t>(columns_.size()), 0 });
+    writer.write_raw(headers.data(), sizeof(ColumnHeader) * headers.size());
+    for (std::size_t index = 0; index != columns_.size(); ++index) {
+        writer.data.resize(headers[index].offset);
+        writer.write_raw(columns_[index].data.data(), columns_[index].data.size());
+    }
+    writer.save(path);
+}
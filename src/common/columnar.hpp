@@ -0,0 +1,231 @@
+#pragma once
+#include <array>
+#include <cinttypes>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Column store meant to be mapped and scanned in place, reader part depends on nothing but std.
+//
+// Layout, all integers little endian, every column starts 8 byte aligned:
+//   FileHeader, then column_count ColumnHeader, then column data.
+//   U32/U64: count values.
+//   Fixed: count values of width bytes each.
+//   String: count + 1 u64 offsets into bytes that follow them, value i spans offsets[i] to offsets[i + 1].
+// Dictionary encoded column "x" holds U32 indexes into String column "x.dict".
+namespace columnar {
+    inline constexpr auto MAGIC = std::array { 'B', 'C', 'O', 'L' };
+    inline constexpr auto VERSION = std::uint32_t{1};
+
+    enum class Type : std::uint32_t {
+        U32 = 1,
+        U64 = 2,
+        Fixed = 3,
+        String = 4,
+    };
+
+    struct FileHeader {
+        std::array<char, 4> magic;
+        std::uint32_t version;
+        std::uint64_t rows;
+        std::uint32_t column_count;
+        std::uint32_t reserved;
+    };
+
+    struct ColumnHeader {
+        std::array<char, 32> name;
+        Type type;
+        std::uint32_t width;
+        std::uint64_t count;
+        std::uint64_t offset;
+        std::uint64_t size;
+
+        inline std::string_view name_view() const noexcept {
+            auto const view = std::string_view { name.data(), name.size() };
+            return view.substr(0, view.find('\0'));
+        }
+    };
+
+    struct Strings {
+        std::span<std::uint64_t const> offsets;
+        std::span<char const> bytes;
+
+        inline std::size_t size() const noexcept {
+            return offsets.empty() ? 0 : offsets.size() - 1;
+        }
+
+        inline std::u8string_view operator[](std::size_t index) const noexcept {
+            auto const begin = offsets[index];
+            return { reinterpret_cast<char8_t const*>(bytes.data() + begin), offsets[index + 1] - begin };
+        }
+    };
+
+    struct Fixed {
+        std::uint32_t width;
+        std::span<unsigned char const> data;
+
+        inline std::size_t size() const noexcept {
+            return width ? data.size() / width : 0;
+        }
+
+        inline std::span<unsigned char const> operator[](std::size_t index) const noexcept {
+            return data.subspan(index * width, width);
+        }
+    };
+
+    // Views into mapped file, valid as long as mapping is, missing or mistyped columns come back empty.
+    struct Reader {
+        [[nodiscard]] inline bool open(std::span<char const> data) noexcept {
+            data_ = {};
+            columns_ = {};
+            if (data.size() < sizeof(FileHeader) || reinterpret_cast<std::uintptr_t>(data.data()) % 8) {
+                return false;
+            }
+            auto header = FileHeader{};
+            std::memcpy(&header, data.data(), sizeof(FileHeader));
+            if (header.magic != MAGIC || header.version != VERSION) {
+                return false;
+            }
+            auto const max_columns = (data.size() - sizeof(FileHeader)) / sizeof(ColumnHeader);
+            if (header.column_count > max_columns) {
+                return false;
+            }
+            auto const columns = std::span { reinterpret_cast<ColumnHeader const*>(data.data() + sizeof(FileHeader)),
+                                             header.column_count };
+            for (auto const& column: columns) {
+                if (column.offset % 8 || column.offset > data.size() || column.size > data.size() - column.offset) {
+                    return false;
+                }
+                if (column.type == Type::String && !valid_strings(data, column)) {
+                    return false;
+                }
+            }
+            rows_ = header.rows;
+            data_ = data;
+            columns_ = columns;
+            return true;
+        }
+
+        inline std::uint64_t rows() const noexcept {
+            return rows_;
+        }
+
+        inline std::span<ColumnHeader const> columns() const noexcept {
+            return columns_;
+        }
+
+        inline ColumnHeader const* find(std::string_view name) const noexcept {
+            for (auto const& column: columns_) {
+                if (column.name_view() == name) {
+                    return &column;
+                }
+            }
+            return nullptr;
+        }
+
+        inline std::span<std::uint32_t const> u32(std::string_view name) const noexcept {
+            return values<std::uint32_t>(name, Type::U32);
+        }
+
+        inline std::span<std::uint64_t const> u64(std::string_view name) const noexcept {
+            return values<std::uint64_t>(name, Type::U64);
+        }
+
+        inline Fixed fixed(std::string_view name) const noexcept {
+            auto const column = find(name);
+            if (!column || column->type != Type::Fixed || !column->width
+                || column->size / column->width < column->count) {
+                return {};
+            }
+            return { column->width, { reinterpret_cast<unsigned char const*>(data_.data() + column->offset),
+                                      column->count * column->width } };
+        }
+
+        inline Strings strings(std::string_view name) const noexcept {
+            auto const column = find(name);
+            if (!column || column->type != Type::String) {
+                return {};
+            }
+            auto const offsets = std::span { reinterpret_cast<std::uint64_t const*>(data_.data() + column->offset),
+                                             column->count + 1 };
+            auto const bytes = data_.subspan(column->offset + offsets.size_bytes(), column->size - offsets.size_bytes());
+            return { offsets, bytes };
+        }
+
+    private:
+        std::span<char const> data_ = {};
+        std::span<ColumnHeader const> columns_ = {};
+        std::uint64_t rows_ = {};
+
+        // Offsets are checked once here, so every view strings() hands out stays inside its column
+        static inline bool valid_strings(std::span<char const> data, ColumnHeader const& column) noexcept {
+            if (column.count >= column.size / 8) {
+                return false;
+            }
+            auto const offsets = std::span { reinterpret_cast<std::uint64_t const*>(data.data() + column.offset),
+                                             column.count + 1 };
+            auto const bytes_size = column.size - offsets.size_bytes();
+            if (offsets.front() != 0 || offsets.back() > bytes_size) {
+                return false;
+            }
+            for (std::size_t index = 1; index != offsets.size(); ++index) {
+                if (offsets[index] < offsets[index - 1]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        template <typename T>
+        inline std::span<T const> values(std::string_view name, Type type) const noexcept {
+            auto const column = find(name);
+            if (!column || column->type != type || column->size / sizeof(T) < column->count) {
+                return {};
+            }
+            return { reinterpret_cast<T const*>(data_.data() + column->offset), column->count };
+        }
+    };
+
+    // Strings appended one after another, index of each is order of append.
+    struct StringsBuilder {
+        std::vector<std::uint64_t> offsets = { 0 };
+        std::vector<char> bytes = {};
+
+        std::uint64_t push(std::u8string_view value);
+    };
+
+    // Same string always maps to same index.
+    struct DictionaryBuilder {
+        StringsBuilder strings = {};
+        std::unordered_map<std::u8string, std::uint32_t> indexes = {};
+
+        std::uint32_t intern(std::u8string_view value);
+    };
+
+    struct Writer {
+        explicit Writer(std::uint64_t rows) : rows_(rows) {}
+
+        void add(std::string_view name, std::span<std::uint32_t const> values);
+        void add(std::string_view name, std::span<std::uint64_t const> values);
+        void add(std::string_view name, std::uint32_t width, std::span<unsigned char const> values);
+        void add(std::string_view name, StringsBuilder const& values);
+        void add(std::string_view name, DictionaryBuilder const& values, std::span<std::uint32_t const> indexes);
+
+        void save(std::filesystem::path const& path) const;
+
+    private:
+        struct Column {
+            ColumnHeader header;
+            std::vector<char> data;
+        };
+        std::uint64_t rows_;
+        std::vector<Column> columns_;
+
+        void add(std::string_view name, Type type, std::uint32_t width, std::uint64_t count,
+                 std::span<char const> head, std::span<char const> tail = {});
+    };
+}
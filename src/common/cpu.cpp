@@ -0,0 +1,96 @@
+#include <common/cpu.hpp>
+#include <cinttypes>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CPU_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CPU_ARM64
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+#endif
+
+namespace {
+    struct Features {
+        bool avx2 = {};
+        bool avx512f = {};
+        bool sha256 = {};
+    };
+}
+
+#ifdef CPU_X86
+static void cpuid(std::uint32_t leaf, std::uint32_t subleaf, std::uint32_t* regs) noexcept {
+#ifdef _MSC_VER
+    int info[4] = {};
+    __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i != 4; ++i) {
+        regs[i] = static_cast<std::uint32_t>(info[i]);
+    }
+#else
+    regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    __get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+}
+
+static std::uint64_t xgetbv() noexcept {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    std::uint32_t eax = {};
+    std::uint32_t edx = {};
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (std::uint64_t{edx} << 32) | eax;
+#endif
+}
+#endif
+
+static Features const& features() noexcept {
+    static auto const result = [] {
+        auto result = Features{};
+#if defined(CPU_X86)
+        std::uint32_t leaf0[4] = {};
+        std::uint32_t leaf1[4] = {};
+        std::uint32_t leaf7[4] = {};
+        cpuid(0, 0, leaf0);
+        cpuid(1, 0, leaf1);
+        if (leaf0[0] >= 7) {
+            cpuid(7, 0, leaf7);
+        }
+        auto const sse41 = (leaf1[2] >> 19) & 1;
+        auto const ssse3 = (leaf1[2] >> 9) & 1;
+        auto const osxsave = (leaf1[2] >> 27) & 1;
+        auto const xcr0 = osxsave ? xgetbv() : 0;
+        // ymm state for avx2, additionally opmask and zmm state for avx512
+        result.avx2 = ((leaf7[1] >> 5) & 1) && (xcr0 & 0x6) == 0x6;
+        result.avx512f = ((leaf7[1] >> 16) & 1) && (xcr0 & 0xe6) == 0xe6;
+        result.sha256 = ((leaf7[1] >> 29) & 1) && sse41 && ssse3;
+#elif defined(CPU_ARM64) && defined(__APPLE__)
+        result.sha256 = true;
+#elif defined(CPU_ARM64) && defined(__linux__)
+        result.sha256 = getauxval(AT_HWCAP) & HWCAP_SHA2;
+#elif defined(CPU_ARM64) && defined(_WIN32)
+        result.sha256 = IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE);
+#endif
+        return result;
+    }();
+    return result;
+}
+
+bool cpu::has_avx2() noexcept {
+    return features().avx2;
+}
+
+bool cpu::has_avx512f() noexcept {
+    return features().avx512f;
+}
+
+bool cpu::has_sha256() noexcept {
+    return features().sha256;
+}
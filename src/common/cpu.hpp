@@ -0,0 +1,9 @@
+#pragma once
+
+// Runtime cpu feature checks, cover both cpu and os support of the registers involved.
+namespace cpu {
+    extern bool has_avx2() noexcept;
+    extern bool has_avx512f() noexcept;
+    // x86 sha extensions or armv8 sha2 instructions
+    extern bool has_sha256() noexcept;
+}
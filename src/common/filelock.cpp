@@ -0,0 +1,81 @@
+#include "filelock.hpp"
+#include <errno.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#endif
+
+auto FileLock::lock(std::filesystem::path const& path) noexcept -> MMapError {
+    this->unlock();
+#ifdef _WIN32
+    auto const raw_file_handle = ::CreateFile(path.string().c_str(),
+                                              GENERIC_READ | GENERIC_WRITE,
+                                              FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                              0,
+                                              OPEN_ALWAYS,
+                                              FILE_ATTRIBUTE_NORMAL,
+                                              0);
+    if (raw_file_handle == INVALID_HANDLE_VALUE || raw_file_handle == nullptr) {
+        return MMapError::with_header("open lock file");
+    }
+    auto overlapped = OVERLAPPED{};
+    if (::LockFileEx(raw_file_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped) == FALSE) {
+        auto error = MMapError::with_header("lock file");
+        ::CloseHandle(raw_file_handle);
+        return error;
+    }
+    this->file_handle_ = reinterpret_cast<std::intptr_t>(raw_file_handle);
+#else
+    for (;;) {
+        auto const raw_file_handle = ::open(path.string().c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (raw_file_handle == -1) {
+            return MMapError::with_header("open lock file");
+        }
+        if (::flock(raw_file_handle, LOCK_EX) != 0) {
+            if (errno == EINTR) {
+                ::close(raw_file_handle);
+                continue;
+            }
+            auto error = MMapError::with_header("lock file");
+            ::close(raw_file_handle);
+            return error;
+        }
+        // Previous holder may have removed marker while we waited, then our lock guards nothing
+        struct ::stat locked_stat = {};
+        struct ::stat path_stat = {};
+        if (::fstat(raw_file_handle, &locked_stat) == 0
+            && ::stat(path.string().c_str(), &path_stat) == 0
+            && locked_stat.st_dev == path_stat.st_dev
+            && locked_stat.st_ino == path_stat.st_ino) {
+            this->file_handle_ = static_cast<std::intptr_t>(raw_file_handle);
+            break;
+        }
+        ::close(raw_file_handle);
+    }
+#endif
+    this->path_ = path;
+    return {};
+}
+
+auto FileLock::unlock(bool remove) noexcept -> void {
+    if (this->file_handle_ == 0) {
+        return;
+    }
+#ifdef _WIN32
+    // Open handles keep marker from being deleted, it is left for next holder
+    (void)remove;
+    ::CloseHandle(reinterpret_cast<HANDLE>(this->file_handle_));
+#else
+    if (remove) {
+        ::unlink(this->path_.string().c_str());
+    }
+    ::close(static_cast<int>(this->file_handle_));
+#endif
+    this->file_handle_ = 0;
+    this->path_.clear();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <common/mmap.hpp>
+#include <filesystem>
+
+// Advisory exclusive lock on a marker file, shared between processes.
+// Kernel drops the lock when holder dies so a crashed process never leaves it stuck.
+struct FileLock {
+    [[nodiscard]] inline FileLock() noexcept = default;
+    inline FileLock(FileLock const& other) = delete;
+    [[nodiscard]] inline FileLock(FileLock&& other) noexcept {
+        std::swap(file_handle_, other.file_handle_);
+        std::swap(path_, other.path_);
+    }
+    inline FileLock& operator=(FileLock const& other) = delete;
+    inline FileLock& operator=(FileLock&& other) noexcept {
+        FileLock tmp = static_cast<FileLock&&>(other);
+        std::swap(file_handle_, tmp.file_handle_);
+        std::swap(path_, tmp.path_);
+        return *this;
+    }
+    inline ~FileLock() noexcept {
+        this->unlock();
+    }
+
+    // Creates marker if needed and blocks until lock is held.
+    [[nodiscard]] auto lock(std::filesystem::path const& path) noexcept -> MMapError;
+    // Removing marker is safe against waiters, they notice and lock the new marker instead.
+    auto unlock(bool remove = false) noexcept -> void;
+
+    [[nodiscard]] inline explicit operator bool() const noexcept {
+        return file_handle_ != 0;
+    }
+    [[nodiscard]] inline bool operator!() const noexcept {
+        return file_handle_ == 0;
+    }
+
+private:
+    std::intptr_t file_handle_ = {};
+    std::filesystem::path path_ = {};
+};
@@ -0,0 +1,88 @@
+#include <common/cpu.hpp>
+#include <common/mbhash_kernel.hpp>
+#include <algorithm>
+#include <vector>
+#include <digestpp.hpp>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MBHASH_SSE2
+#endif
+
+using namespace mbhash;
+
+#ifdef MBHASH_SSE2
+namespace {
+    struct LanesSSE2 {
+        using V = __m128i;
+        static constexpr std::size_t N = 4;
+
+        static inline V load(std::uint32_t const* src) noexcept {
+            return _mm_load_si128(reinterpret_cast<V const*>(src));
+        }
+        static inline void store(std::uint32_t* dst, V x) noexcept {
+            _mm_store_si128(reinterpret_cast<V*>(dst), x);
+        }
+        static inline V set1(std::uint32_t x) noexcept { return _mm_set1_epi32(static_cast<int>(x)); }
+        static inline V add(V x, V y) noexcept { return _mm_add_epi32(x, y); }
+        static inline V bxor(V x, V y) noexcept { return _mm_xor_si128(x, y); }
+        static inline V band(V x, V y) noexcept { return _mm_and_si128(x, y); }
+        static inline V bor(V x, V y) noexcept { return _mm_or_si128(x, y); }
+        template<int R>
+        static inline V rotl(V x) noexcept {
+            return _mm_or_si128(_mm_slli_epi32(x, R), _mm_srli_epi32(x, 32 - R));
+        }
+    };
+}
+#endif
+
+static bool (*find_backend(std::size_t& lanes))(detail::Message const*, std::size_t) {
+    // Empty batch only probes whether backend was compiled in
+    if (cpu::has_avx512f() && detail::md5_sha1_x16(nullptr, 0)) {
+        lanes = 16;
+        return &detail::md5_sha1_x16;
+    }
+    if (cpu::has_avx2() && detail::md5_sha1_x8(nullptr, 0)) {
+        lanes = 8;
+        return &detail::md5_sha1_x8;
+    }
+#ifdef MBHASH_SSE2
+    lanes = 4;
+    return [](detail::Message const* jobs, std::size_t count) {
+        Kernel<LanesSSE2>{}.run(jobs, count);
+        return true;
+    };
+#else
+    lanes = 1;
+    return nullptr;
+#endif
+}
+
+static auto const& backend() noexcept {
+    static auto const result = [] {
+        auto lanes = std::size_t{};
+        auto run = find_backend(lanes);
+        return std::pair { run, lanes };
+    }();
+    return result;
+}
+
+std::size_t mbhash::lanes() noexcept {
+    return backend().second;
+}
+
+void mbhash::md5_sha1(std::span<std::span<char const> const> messages, std::span<Digest> out) {
+    auto const run = backend().first;
+    if (!run) {
+        for (std::size_t i = 0; i != messages.size(); ++i) {
+            digestpp::md5().absorb(messages[i].data(), messages[i].size()).digest(out[i].md5, sizeof(out[i].md5));
+            digestpp::sha1().absorb(messages[i].data(), messages[i].size()).digest(out[i].sha1, sizeof(out[i].sha1));
+        }
+        return;
+    }
+    auto jobs = std::vector<detail::Message>(messages.size());
+    for (std::size_t i = 0; i != messages.size(); ++i) {
+        jobs[i] = { messages[i].data(), messages[i].size(), &out[i] };
+    }
+    std::stable_sort(jobs.begin(), jobs.end(), [](auto const& lhs, auto const& rhs) { return lhs.size > rhs.size; });
+    run(jobs.data(), jobs.size());
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <span>
+
+// Multi-buffer md5 + sha1, independent messages are hashed side by side in simd lanes.
+namespace mbhash {
+    struct Digest {
+        std::uint8_t md5[16];
+        std::uint8_t sha1[20];
+    };
+
+    // Number of messages this cpu hashes at once, 1 when no simd backend is available.
+    extern std::size_t lanes() noexcept;
+
+    // out[i] receives digests of messages[i], messages are scheduled longest first to keep lanes busy.
+    extern void md5_sha1(std::span<std::span<char const> const> messages, std::span<Digest> out);
+}
@@ -0,0 +1,36 @@
+#include <common/mbhash_kernel.hpp>
+#ifdef __AVX2__
+#include <immintrin.h>
+
+namespace {
+    struct LanesAVX2 {
+        using V = __m256i;
+        static constexpr std::size_t N = 8;
+
+        static inline V load(std::uint32_t const* src) noexcept {
+            return _mm256_load_si256(reinterpret_cast<V const*>(src));
+        }
+        static inline void store(std::uint32_t* dst, V x) noexcept {
+            _mm256_store_si256(reinterpret_cast<V*>(dst), x);
+        }
+        static inline V set1(std::uint32_t x) noexcept { return _mm256_set1_epi32(static_cast<int>(x)); }
+        static inline V add(V x, V y) noexcept { return _mm256_add_epi32(x, y); }
+        static inline V bxor(V x, V y) noexcept { return _mm256_xor_si256(x, y); }
+        static inline V band(V x, V y) noexcept { return _mm256_and_si256(x, y); }
+        static inline V bor(V x, V y) noexcept { return _mm256_or_si256(x, y); }
+        template<int R>
+        static inline V rotl(V x) noexcept {
+            return _mm256_or_si256(_mm256_slli_epi32(x, R), _mm256_srli_epi32(x, 32 - R));
+        }
+    };
+}
+#endif
+
+bool mbhash::detail::md5_sha1_x8(Message const* jobs, std::size_t count) {
+#ifdef __AVX2__
+    Kernel<LanesAVX2>{}.run(jobs, count);
+    return true;
+#else
+    return false;
+#endif
+}
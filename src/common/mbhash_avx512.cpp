@@ -0,0 +1,30 @@
+#include <common/mbhash_kernel.hpp>
+#ifdef __AVX512F__
+#include <immintrin.h>
+
+namespace {
+    struct LanesAVX512 {
+        using V = __m512i;
+        static constexpr std::size_t N = 16;
+
+        static inline V load(std::uint32_t const* src) noexcept { return _mm512_load_si512(src); }
+        static inline void store(std::uint32_t* dst, V x) noexcept { _mm512_store_si512(dst, x); }
+        static inline V set1(std::uint32_t x) noexcept { return _mm512_set1_epi32(static_cast<int>(x)); }
+        static inline V add(V x, V y) noexcept { return _mm512_add_epi32(x, y); }
+        static inline V bxor(V x, V y) noexcept { return _mm512_xor_si512(x, y); }
+        static inline V band(V x, V y) noexcept { return _mm512_and_si512(x, y); }
+        static inline V bor(V x, V y) noexcept { return _mm512_or_si512(x, y); }
+        template<int R>
+        static inline V rotl(V x) noexcept { return _mm512_rol_epi32(x, R); }
+    };
+}
+#endif
+
+bool mbhash::detail::md5_sha1_x16(Message const* jobs, std::size_t count) {
+#ifdef __AVX512F__
+    Kernel<LanesAVX512>{}.run(jobs, count);
+    return true;
+#else
+    return false;
+#endif
+}
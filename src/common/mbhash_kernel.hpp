@@ -0,0 +1,243 @@
+#pragma once
+#include <common/mbhash.hpp>
+#include <cstring>
+#include <utility>
+
+namespace mbhash::detail {
+    struct Message {
+        char const* data;
+        std::size_t size;
+        Digest* out;
+    };
+
+    // Wider backends live in their own translation units built with matching isa flags,
+    // they return false when compiler could not build them.
+    extern bool md5_sha1_x8(Message const* jobs, std::size_t count);
+    extern bool md5_sha1_x16(Message const* jobs, std::size_t count);
+}
+
+// Only included by per isa translation units, internal linkage keeps wide instructions out of other paths.
+namespace {
+    // L provides lane type V, lane count N and add/bxor/band/bor/set1/load/store/rotl<R> over it.
+    template<typename L>
+    struct Kernel {
+        using V = typename L::V;
+        static constexpr std::size_t N = L::N;
+
+        void run(mbhash::detail::Message const* jobs, std::size_t count) noexcept {
+            std::size_t next = 0;
+            for (std::size_t l = 0; l != N; ++l) {
+                assign(l, next != count ? &jobs[next++] : nullptr);
+            }
+            while (active_) {
+                gather();
+                transform();
+                for (std::size_t l = 0; l != N; ++l) {
+                    auto& lane = lanes_[l];
+                    if (lane.job && ++lane.block == lane.blocks_total) {
+                        finish(l);
+                        assign(l, next != count ? &jobs[next++] : nullptr);
+                    }
+                }
+            }
+        }
+
+    private:
+        struct Lane {
+            mbhash::detail::Message const* job;
+            std::uint8_t const* data;
+            std::size_t block;
+            std::size_t blocks_full;
+            std::size_t blocks_total;
+            std::uint8_t tail_md5[128];
+            std::uint8_t tail_sha1[128];
+        };
+
+        static constexpr std::uint32_t MD5_K[64] = {
+            0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+            0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+            0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+            0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+            0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+            0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+            0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+            0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+        };
+
+        static constexpr int MD5_S[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+
+        static constexpr std::uint32_t MD5_IV[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+        static constexpr std::uint32_t SHA1_IV[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+        static constexpr std::uint8_t ZERO_BLOCK[64] = {};
+
+        alignas(64) std::uint32_t md5_state_[4][N] = {};
+        alignas(64) std::uint32_t sha1_state_[5][N] = {};
+        alignas(64) std::uint32_t words_le_[16][N] = {};
+        alignas(64) std::uint32_t words_be_[16][N] = {};
+        Lane lanes_[N] = {};
+        std::size_t active_ = {};
+
+        void assign(std::size_t l, mbhash::detail::Message const* job) noexcept {
+            auto& lane = lanes_[l];
+            lane.job = job;
+            if (!job) {
+                return;
+            }
+            ++active_;
+            auto const tail = job->size % 64;
+            lane.data = reinterpret_cast<std::uint8_t const*>(job->data);
+            lane.block = 0;
+            lane.blocks_full = job->size / 64;
+            lane.blocks_total = lane.blocks_full + (tail + 9 <= 64 ? 1 : 2);
+            // Both digests pad the same way except for the endianness of bit length
+            auto const tail_size = (lane.blocks_total - lane.blocks_full) * 64;
+            auto const bits = static_cast<std::uint64_t>(job->size) * 8;
+            std::memset(lane.tail_md5, 0, sizeof(lane.tail_md5));
+            if (tail) {
+                std::memcpy(lane.tail_md5, lane.data + lane.blocks_full * 64, tail);
+            }
+            lane.tail_md5[tail] = 0x80;
+            std::memcpy(lane.tail_sha1, lane.tail_md5, sizeof(lane.tail_sha1));
+            for (std::size_t i = 0; i != 8; ++i) {
+                lane.tail_md5[tail_size - 8 + i] = static_cast<std::uint8_t>(bits >> (8 * i));
+                lane.tail_sha1[tail_size - 1 - i] = static_cast<std::uint8_t>(bits >> (8 * i));
+            }
+            for (std::size_t k = 0; k != 4; ++k) {
+                md5_state_[k][l] = MD5_IV[k];
+            }
+            for (std::size_t k = 0; k != 5; ++k) {
+                sha1_state_[k][l] = SHA1_IV[k];
+            }
+        }
+
+        void finish(std::size_t l) noexcept {
+            auto const out = lanes_[l].job->out;
+            --active_;
+            for (std::size_t k = 0; k != 4; ++k) {
+                for (std::size_t b = 0; b != 4; ++b) {
+                    out->md5[k * 4 + b] = static_cast<std::uint8_t>(md5_state_[k][l] >> (8 * b));
+                }
+            }
+            for (std::size_t k = 0; k != 5; ++k) {
+                for (std::size_t b = 0; b != 4; ++b) {
+                    out->sha1[k * 4 + b] = static_cast<std::uint8_t>(sha1_state_[k][l] >> (24 - 8 * b));
+                }
+            }
+        }
+
+        void gather() noexcept {
+            for (std::size_t l = 0; l != N; ++l) {
+                auto const& lane = lanes_[l];
+                auto md5 = ZERO_BLOCK;
+                auto sha1 = ZERO_BLOCK;
+                if (lane.job && lane.block < lane.blocks_full) {
+                    md5 = sha1 = lane.data + lane.block * 64;
+                } else if (lane.job) {
+                    md5 = lane.tail_md5 + (lane.block - lane.blocks_full) * 64;
+                    sha1 = lane.tail_sha1 + (lane.block - lane.blocks_full) * 64;
+                }
+                for (std::size_t j = 0; j != 16; ++j) {
+                    auto const le = md5 + j * 4;
+                    auto const be = sha1 + j * 4;
+                    words_le_[j][l] = std::uint32_t{le[0]} | std::uint32_t{le[1]} << 8
+                                      | std::uint32_t{le[2]} << 16 | std::uint32_t{le[3]} << 24;
+                    words_be_[j][l] = std::uint32_t{be[3]} | std::uint32_t{be[2]} << 8
+                                      | std::uint32_t{be[1]} << 16 | std::uint32_t{be[0]} << 24;
+                }
+            }
+        }
+
+        template<std::size_t I>
+        static inline void md5_step(V* s, V const* m) noexcept {
+            V& a = s[(4 - I % 4) % 4];
+            V const& b = s[(5 - I % 4) % 4];
+            V const& c = s[(6 - I % 4) % 4];
+            V const& d = s[(7 - I % 4) % 4];
+            V f;
+            std::size_t g;
+            if constexpr (I < 16) {
+                f = L::bxor(d, L::band(b, L::bxor(c, d)));
+                g = I;
+            } else if constexpr (I < 32) {
+                f = L::bxor(c, L::band(d, L::bxor(b, c)));
+                g = (5 * I + 1) % 16;
+            } else if constexpr (I < 48) {
+                f = L::bxor(L::bxor(b, c), d);
+                g = (3 * I + 5) % 16;
+            } else {
+                f = L::bxor(c, L::bor(b, L::bxor(d, L::set1(0xffffffff))));
+                g = (7 * I) % 16;
+            }
+            auto const t = L::add(L::add(a, f), L::add(L::set1(MD5_K[I]), m[g]));
+            a = L::add(b, L::template rotl<MD5_S[I / 16 * 4 + I % 4]>(t));
+        }
+
+        template<std::size_t I>
+        static inline void sha1_step(V* s, V* w) noexcept {
+            V const& a = s[(5 - I % 5) % 5];
+            V& b = s[(6 - I % 5) % 5];
+            V const& c = s[(7 - I % 5) % 5];
+            V const& d = s[(8 - I % 5) % 5];
+            V& e = s[(9 - I % 5) % 5];
+            if constexpr (I >= 16) {
+                auto const x = L::bxor(L::bxor(w[(I - 3) % 16], w[(I - 8) % 16]),
+                                       L::bxor(w[(I - 14) % 16], w[I % 16]));
+                w[I % 16] = L::template rotl<1>(x);
+            }
+            V f;
+            std::uint32_t k;
+            if constexpr (I < 20) {
+                f = L::bxor(d, L::band(b, L::bxor(c, d)));
+                k = 0x5a827999;
+            } else if constexpr (I < 40) {
+                f = L::bxor(L::bxor(b, c), d);
+                k = 0x6ed9eba1;
+            } else if constexpr (I < 60) {
+                f = L::bor(L::band(b, c), L::band(d, L::bor(b, c)));
+                k = 0x8f1bbcdc;
+            } else {
+                f = L::bxor(L::bxor(b, c), d);
+                k = 0xca62c1d6;
+            }
+            e = L::add(L::add(L::template rotl<5>(a), f), L::add(e, L::add(L::set1(k), w[I % 16])));
+            b = L::template rotl<30>(b);
+        }
+
+        template<std::size_t... I>
+        static inline void md5_rounds(V* s, V const* m, std::index_sequence<I...>) noexcept {
+            (md5_step<I>(s, m), ...);
+        }
+
+        template<std::size_t... I>
+        static inline void sha1_rounds(V* s, V* w, std::index_sequence<I...>) noexcept {
+            (sha1_step<I>(s, w), ...);
+        }
+
+        void transform() noexcept {
+            V s[5];
+            V m[16];
+            for (std::size_t k = 0; k != 4; ++k) {
+                s[k] = L::load(md5_state_[k]);
+            }
+            for (std::size_t j = 0; j != 16; ++j) {
+                m[j] = L::load(words_le_[j]);
+            }
+            md5_rounds(s, m, std::make_index_sequence<64>{});
+            for (std::size_t k = 0; k != 4; ++k) {
+                L::store(md5_state_[k], L::add(L::load(md5_state_[k]), s[k]));
+            }
+            for (std::size_t k = 0; k != 5; ++k) {
+                s[k] = L::load(sha1_state_[k]);
+            }
+            for (std::size_t j = 0; j != 16; ++j) {
+                m[j] = L::load(words_be_[j]);
+            }
+            sha1_rounds(s, m, std::make_index_sequence<80>{});
+            for (std::size_t k = 0; k != 5; ++k) {
+                L::store(sha1_state_[k], L::add(L::load(sha1_state_[k]), s[k]));
+            }
+        }
+    };
+}
@@ -0,0 +1,201 @@
+#include <common/bt_error.hpp>
+#include <common/output.hpp>
+#include <algorithm>
+#include <errno.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static constexpr auto BINARY_MAGIC = std::string_view { "BCRS" };
+static constexpr auto BINARY_VERSION = std::uint32_t{1};
+
+OutputSink::OutputSink(int fd, Format format) : fd_(fd), format_(format) {}
+
+OutputSink::~OutputSink() {
+    // Reader may have gone away already, nothing left to tell it
+    try {
+        flush();
+    } catch (std::exception const&) {
+        bt::error_stack().clear();
+    }
+}
+
+void OutputSink::set_format(Format format) {
+    bt_assert(!started_);
+    format_ = format;
+}
+
+OutputSink::Format OutputSink::parse_format(std::string_view name) {
+    if (name == "csv") {
+        return Format::Csv;
+    } else if (name == "ndjson") {
+        return Format::Ndjson;
+    } else if (name == "binary") {
+        return Format::Binary;
+    }
+    throw std::runtime_error("Unknown output format!");
+}
+
+void OutputSink::record(std::initializer_list<Field> fields) {
+    record(std::span { fields.begin(), fields.size() });
+}
+
+void OutputSink::record(std::span<Field const> fields) {
+    if (!started_) {
+        started_ = true;
+        if (format_ == Format::Binary) {
+#ifdef _WIN32
+            ::_setmode(fd_, _O_BINARY);
+#endif
+            append(BINARY_MAGIC);
+            append_le(BINARY_VERSION);
+        }
+    }
+    switch (format_) {
+    case Format::Csv:
+        write_csv(fields);
+        break;
+    case Format::Ndjson:
+        write_ndjson(fields);
+        break;
+    case Format::Binary:
+        write_binary(fields);
+        break;
+    }
+    if (buffer_.size() >= FLUSH_SIZE) {
+        flush();
+    }
+}
+
+void OutputSink::flush() {
+    auto data = std::string_view { buffer_.data(), buffer_.size() };
+    while (!data.empty()) {
+#ifdef _WIN32
+        auto const written = ::_write(fd_, data.data(), static_cast<unsigned>(std::min(data.size(), std::size_t{1} << 30)));
+#else
+        auto const written = ::write(fd_, data.data(), data.size());
+#endif
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            buffer_.clear();
+            bt_assert(!"Failed to write output!");
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+    }
+    buffer_.clear();
+}
+
+void OutputSink::write_csv(std::span<Field const> fields) {
+    auto out = std::back_inserter(buffer_);
+    for (bool first = true; auto const& field: fields) {
+        if (!first) {
+            buffer_.push_back(',');
+        }
+        first = false;
+        if (auto const number = std::get_if<std::uint64_t>(&field.value)) {
+            fmt::format_to(out, "{}", *number);
+        } else if (auto const hash = std::get_if<Hash>(&field.value)) {
+            fmt::format_to(out, "{:016x}", hash->value);
+        } else {
+            auto const str = std::get<std::u8string_view>(field.value);
+            append({ reinterpret_cast<char const*>(str.data()), str.size() });
+        }
+    }
+    buffer_.push_back('\n');
+}
+
+void OutputSink::write_ndjson(std::span<Field const> fields) {
+    auto out = std::back_inserter(buffer_);
+    buffer_.push_back('{');
+    for (bool first = true; auto const& field: fields) {
+        if (!first) {
+            buffer_.push_back(',');
+        }
+        first = false;
+        fmt::format_to(out, "\"{}\":", field.name);
+        if (auto const number = std::get_if<std::uint64_t>(&field.value)) {
+            fmt::format_to(out, "{}", *number);
+        } else if (auto const hash = std::get_if<Hash>(&field.value)) {
+            fmt::format_to(out, "\"{:016x}\"", hash->value);
+        } else {
+            append_json_string(std::get<std::u8string_view>(field.value));
+        }
+    }
+    append("}\n");
+}
+
+void OutputSink::write_binary(std::span<Field const> fields) {
+    auto const same_schema = std::equal(schema_.begin(), schema_.end(), fields.begin(), fields.end(),
+                                        [](std::string_view name, Field const& field) { return name == field.name; });
+    if (!same_schema) {
+        schema_.clear();
+        buffer_.push_back('S');
+        append_le(static_cast<std::uint16_t>(fields.size()));
+        for (auto const& field: fields) {
+            bt_assert(field.name.size() <= 0xFF);
+            buffer_.push_back(static_cast<char>(field.name.size()));
+            append(field.name);
+            schema_.push_back(field.name);
+        }
+    }
+    buffer_.push_back('R');
+    for (auto const& field: fields) {
+        buffer_.push_back(static_cast<char>(field.value.index()));
+        if (auto const number = std::get_if<std::uint64_t>(&field.value)) {
+            append_le(*number);
+        } else if (auto const hash = std::get_if<Hash>(&field.value)) {
+            append_le(hash->value);
+        } else {
+            auto const str = std::get<std::u8string_view>(field.value);
+            append_le(static_cast<std::uint32_t>(str.size()));
+            append({ reinterpret_cast<char const*>(str.data()), str.size() });
+        }
+    }
+}
+
+void OutputSink::append(std::string_view data) {
+    buffer_.append(data.data(), data.data() + data.size());
+}
+
+void OutputSink::append_json_string(std::u8string_view data) {
+    buffer_.push_back('"');
+    auto out = std::back_inserter(buffer_);
+    for (auto const c: data) {
+        switch (c) {
+        case u8'"':
+            append("\\\"");
+            break;
+        case u8'\\':
+            append("\\\\");
+            break;
+        case u8'\n':
+            append("\\n");
+            break;
+        case u8'\r':
+            append("\\r");
+            break;
+        case u8'\t':
+            append("\\t");
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                fmt::format_to(out, "\\u{:04x}", static_cast<unsigned>(c));
+            } else {
+                buffer_.push_back(static_cast<char>(c));
+            }
+        }
+    }
+    buffer_.push_back('"');
+}
+
+template <typename T>
+void OutputSink::append_le(T value) {
+    for (std::size_t i = 0; i != sizeof(T); ++i) {
+        buffer_.push_back(static_cast<char>(value >> (i * 8)));
+    }
+}
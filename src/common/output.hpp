@@ -0,0 +1,65 @@
+#pragma once
+#include <fmt/format.h>
+#include <cinttypes>
+#include <initializer_list>
+#include <span>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// Record writer that batches output into large blocks written straight to a file descriptor.
+//
+// Csv: fields joined with commas, one record per line, no escaping.
+// Ndjson: one json object per line, hashes are hex strings since json numbers can not hold them.
+// Binary: "BCRS" magic and u32 version, then records tagged by first byte, all integers little endian:
+//   'S' u16 count, per field u8 size and name bytes; describes fields of records that follow.
+//   'R' per field u8 type then value; 0 u64 number, 1 u64 hash, 2 u32 size and bytes of string.
+struct OutputSink {
+    enum class Format : std::uint8_t {
+        Csv,
+        Ndjson,
+        Binary,
+    };
+
+    struct Hash {
+        std::uint64_t value;
+    };
+
+    struct Field {
+        std::string_view name;
+        std::variant<std::uint64_t, Hash, std::u8string_view> value;
+    };
+
+    OutputSink(int fd = 1, Format format = Format::Csv);
+    OutputSink(OutputSink const&) = delete;
+    OutputSink& operator=(OutputSink const&) = delete;
+    ~OutputSink();
+
+    // Only valid before anything was written.
+    void set_format(Format format);
+
+    void record(std::initializer_list<Field> fields);
+    void record(std::span<Field const> fields);
+
+    // Also done once buffer grows past FLUSH_SIZE and on destruction.
+    void flush();
+
+    static constexpr std::size_t FLUSH_SIZE = 1024 * 1024;
+
+    static Format parse_format(std::string_view name);
+
+private:
+    int fd_;
+    Format format_;
+    bool started_ = {};
+    fmt::memory_buffer buffer_;
+    std::vector<std::string_view> schema_;
+
+    void write_csv(std::span<Field const> fields);
+    void write_ndjson(std::span<Field const> fields);
+    void write_binary(std::span<Field const> fields);
+    void append(std::string_view data);
+    void append_json_string(std::u8string_view data);
+    template <typename T>
+    void append_le(T value);
+};
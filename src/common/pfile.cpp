@@ -0,0 +1,161 @@
+#include "pfile.hpp"
+#include <algorithm>
+#include <errno.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+auto PFile::open(std::filesystem::path const& path) noexcept -> MMapError {
+    this->close();
+#ifdef _WIN32
+    auto const raw_file_handle = ::CreateFile(path.string().c_str(),
+                                              GENERIC_READ | GENERIC_WRITE,
+                                              FILE_SHARE_READ,
+                                              0,
+                                              OPEN_ALWAYS,
+                                              FILE_ATTRIBUTE_NORMAL,
+                                              0);
+    if (raw_file_handle == INVALID_HANDLE_VALUE || raw_file_handle == nullptr) {
+        return MMapError::with_header("open file handle");
+    }
+    auto raw_file_size = LARGE_INTEGER{};
+    if (::GetFileSizeEx(raw_file_handle, &raw_file_size) == 0) {
+        auto error = MMapError::with_header("get file size");
+        ::CloseHandle(raw_file_handle);
+        return error;
+    }
+    this->file_handle_ = reinterpret_cast<std::intptr_t>(raw_file_handle);
+    this->file_size_ = static_cast<std::size_t>(raw_file_size.QuadPart);
+#else
+    auto const raw_file_handle = ::open(path.string().c_str(), O_RDWR | O_CREAT, 0644);
+    if (raw_file_handle == -1 || raw_file_handle == 0) {
+        return MMapError::with_header("open file handle");
+    }
+    struct ::stat raw_stat = {};
+    if (::fstat(raw_file_handle, &raw_stat) != 0) {
+        auto error = MMapError::with_header("get file size");
+        ::close(raw_file_handle);
+        return error;
+    }
+    this->file_handle_ = static_cast<std::intptr_t>(raw_file_handle);
+    this->file_size_ = static_cast<std::size_t>(raw_stat.st_size);
+#endif
+    return {};
+}
+
+auto PFile::read(std::size_t offset, std::span<char> dst) const noexcept -> MMapError {
+    if (this->file_handle_ == 0) {
+        return { "read closed file", EBADF };
+    }
+#ifdef _WIN32
+    auto const raw_file_handle = reinterpret_cast<HANDLE>(this->file_handle_);
+    while (!dst.empty()) {
+        auto overlapped = OVERLAPPED{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(static_cast<std::uint64_t>(offset) >> 32);
+        auto const want = static_cast<DWORD>(std::min(dst.size(), std::size_t{1} << 30));
+        auto got = DWORD{};
+        if (::ReadFile(raw_file_handle, dst.data(), want, &got, &overlapped) == FALSE) {
+            return MMapError::with_header("read file");
+        }
+        if (got == 0) {
+            return { "read past end of file", ERROR_HANDLE_EOF };
+        }
+        offset += got;
+        dst = dst.subspan(got);
+    }
+#else
+    auto const raw_file_handle = static_cast<int>(this->file_handle_);
+    while (!dst.empty()) {
+        auto const got = ::pread(raw_file_handle, dst.data(), dst.size(), static_cast<off_t>(offset));
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return MMapError::with_header("read file");
+        }
+        if (got == 0) {
+            return { "read past end of file", EIO };
+        }
+        offset += static_cast<std::size_t>(got);
+        dst = dst.subspan(static_cast<std::size_t>(got));
+    }
+#endif
+    return {};
+}
+
+auto PFile::write(std::size_t offset, std::span<char const> src) noexcept -> MMapError {
+    if (this->file_handle_ == 0) {
+        return { "write closed file", EBADF };
+    }
+    auto const end = offset + src.size();
+#ifdef _WIN32
+    auto const raw_file_handle = reinterpret_cast<HANDLE>(this->file_handle_);
+    while (!src.empty()) {
+        auto overlapped = OVERLAPPED{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(static_cast<std::uint64_t>(offset) >> 32);
+        auto const want = static_cast<DWORD>(std::min(src.size(), std::size_t{1} << 30));
+        auto put = DWORD{};
+        if (::WriteFile(raw_file_handle, src.data(), want, &put, &overlapped) == FALSE) {
+            return MMapError::with_header("write file");
+        }
+        offset += put;
+        src = src.subspan(put);
+    }
+#else
+    auto const raw_file_handle = static_cast<int>(this->file_handle_);
+    while (!src.empty()) {
+        auto const put = ::pwrite(raw_file_handle, src.data(), src.size(), static_cast<off_t>(offset));
+        if (put < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return MMapError::with_header("write file");
+        }
+        offset += static_cast<std::size_t>(put);
+        src = src.subspan(static_cast<std::size_t>(put));
+    }
+#endif
+    this->file_size_ = std::max(this->file_size_, end);
+    return {};
+}
+
+auto PFile::resize(std::size_t size) noexcept -> MMapError {
+    if (this->file_handle_ == 0) {
+        return { "resize closed file", EBADF };
+    }
+#ifdef _WIN32
+    auto const raw_file_handle = reinterpret_cast<HANDLE>(this->file_handle_);
+    auto raw_size = LARGE_INTEGER{};
+    raw_size.QuadPart = static_cast<LONGLONG>(size);
+    if (::SetFilePointerEx(raw_file_handle, raw_size, nullptr, FILE_BEGIN) == FALSE
+        || ::SetEndOfFile(raw_file_handle) == FALSE) {
+        return MMapError::with_header("resize file");
+    }
+#else
+    if (::ftruncate(static_cast<int>(this->file_handle_), static_cast<off_t>(size)) != 0) {
+        return MMapError::with_header("resize file");
+    }
+#endif
+    this->file_size_ = size;
+    return {};
+}
+
+auto PFile::close() noexcept -> void {
+    if (this->file_handle_ == 0) {
+        return;
+    }
+#ifdef _WIN32
+    ::CloseHandle(reinterpret_cast<HANDLE>(this->file_handle_));
+#else
+    ::close(static_cast<int>(this->file_handle_));
+#endif
+    this->file_handle_ = 0;
+    this->file_size_ = 0;
+}
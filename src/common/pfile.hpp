@@ -0,0 +1,48 @@
+#pragma once
+#include <common/mmap.hpp>
+#include <filesystem>
+#include <span>
+
+// Read write file handle for positional io, lets patch rewrite changed chunks of a file and cut it to size.
+struct PFile {
+    [[nodiscard]] inline PFile() noexcept = default;
+    inline PFile(PFile const& other) = delete;
+    [[nodiscard]] inline PFile(PFile&& other) noexcept {
+        std::swap(file_handle_, other.file_handle_);
+        std::swap(file_size_, other.file_size_);
+    }
+    inline PFile& operator=(PFile const& other) = delete;
+    inline PFile& operator=(PFile&& other) noexcept {
+        PFile tmp = static_cast<PFile&&>(other);
+        std::swap(file_handle_, tmp.file_handle_);
+        std::swap(file_size_, tmp.file_size_);
+        return *this;
+    }
+    inline ~PFile() noexcept {
+        this->close();
+    }
+
+    // Creates empty file when missing.
+    [[nodiscard]] auto open(std::filesystem::path const& path) noexcept -> MMapError;
+    // Fills whole dst starting at offset, short read is an error.
+    [[nodiscard]] auto read(std::size_t offset, std::span<char> dst) const noexcept -> MMapError;
+    // Writes whole src starting at offset, file grows when needed.
+    [[nodiscard]] auto write(std::size_t offset, std::span<char const> src) noexcept -> MMapError;
+    // Grows with zeros or cuts off tail.
+    [[nodiscard]] auto resize(std::size_t size) noexcept -> MMapError;
+    auto close() noexcept -> void;
+
+    [[nodiscard]] inline auto size() const noexcept {
+        return file_size_;
+    }
+    [[nodiscard]] inline explicit operator bool() const noexcept {
+        return file_handle_ != 0;
+    }
+    [[nodiscard]] inline bool operator!() const noexcept {
+        return file_handle_ == 0;
+    }
+
+private:
+    std::intptr_t file_handle_ = {};
+    std::size_t file_size_ = {};
+};
@@ -0,0 +1,107 @@
+#include "pread.hpp"
+#include <algorithm>
+#include <errno.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+auto PRead::open(std::filesystem::path const& path) noexcept -> MMapError {
+    this->close();
+#ifdef _WIN32
+    auto const raw_file_handle = ::CreateFile(path.string().c_str(),
+                                              GENERIC_READ,
+                                              FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                              0,
+                                              OPEN_EXISTING,
+                                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+                                              0);
+    if (raw_file_handle == INVALID_HANDLE_VALUE || raw_file_handle == nullptr) {
+        return MMapError::with_header("open file handle");
+    }
+    auto raw_file_size = LARGE_INTEGER{};
+    if (::GetFileSizeEx(raw_file_handle, &raw_file_size) == 0) {
+        auto error = MMapError::with_header("get file size");
+        ::CloseHandle(raw_file_handle);
+        return error;
+    }
+    this->file_handle_ = reinterpret_cast<std::intptr_t>(raw_file_handle);
+    this->file_size_ = static_cast<std::size_t>(raw_file_size.QuadPart);
+#else
+    auto const raw_file_handle = ::open(path.string().c_str(), O_RDONLY);
+    if (raw_file_handle == -1 || raw_file_handle == 0) {
+        return MMapError::with_header("open file handle");
+    }
+    struct ::stat raw_stat = {};
+    if (::fstat(raw_file_handle, &raw_stat) != 0) {
+        auto error = MMapError::with_header("get file size");
+        ::close(raw_file_handle);
+        return error;
+    }
+#ifdef POSIX_FADV_RANDOM
+    // Readahead would only pull in neighbouring bytes nobody asked for
+    ::posix_fadvise(raw_file_handle, 0, 0, POSIX_FADV_RANDOM);
+#endif
+    this->file_handle_ = static_cast<std::intptr_t>(raw_file_handle);
+    this->file_size_ = static_cast<std::size_t>(raw_stat.st_size);
+#endif
+    return {};
+}
+
+auto PRead::read(std::size_t offset, std::span<char> dst) const noexcept -> MMapError {
+    if (this->file_handle_ == 0) {
+        return { "read closed file", EBADF };
+    }
+#ifdef _WIN32
+    auto const raw_file_handle = reinterpret_cast<HANDLE>(this->file_handle_);
+    while (!dst.empty()) {
+        auto overlapped = OVERLAPPED{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(static_cast<std::uint64_t>(offset) >> 32);
+        auto const want = static_cast<DWORD>(std::min(dst.size(), std::size_t{1} << 30));
+        auto got = DWORD{};
+        if (::ReadFile(raw_file_handle, dst.data(), want, &got, &overlapped) == FALSE) {
+            return MMapError::with_header("read file");
+        }
+        if (got == 0) {
+            return { "read past end of file", ERROR_HANDLE_EOF };
+        }
+        offset += got;
+        dst = dst.subspan(got);
+    }
+#else
+    auto const raw_file_handle = static_cast<int>(this->file_handle_);
+    while (!dst.empty()) {
+        auto const got = ::pread(raw_file_handle, dst.data(), dst.size(), static_cast<off_t>(offset));
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return MMapError::with_header("read file");
+        }
+        if (got == 0) {
+            return { "read past end of file", EIO };
+        }
+        offset += static_cast<std::size_t>(got);
+        dst = dst.subspan(static_cast<std::size_t>(got));
+    }
+#endif
+    return {};
+}
+
+auto PRead::close() noexcept -> void {
+    if (this->file_handle_ == 0) {
+        return;
+    }
+#ifdef _WIN32
+    ::CloseHandle(reinterpret_cast<HANDLE>(this->file_handle_));
+#else
+    ::close(static_cast<int>(this->file_handle_));
+#endif
+    this->file_handle_ = 0;
+    this->file_size_ = 0;
+}
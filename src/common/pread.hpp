@@ -0,0 +1,43 @@
+#pragma once
+#include <common/mmap.hpp>
+#include <filesystem>
+#include <span>
+
+// Read only file handle for positional reads, for when only small ranges of a big file are needed.
+struct PRead {
+    [[nodiscard]] inline PRead() noexcept = default;
+    inline PRead(PRead const& other) = delete;
+    [[nodiscard]] inline PRead(PRead&& other) noexcept {
+        std::swap(file_handle_, other.file_handle_);
+        std::swap(file_size_, other.file_size_);
+    }
+    inline PRead& operator=(PRead const& other) = delete;
+    inline PRead& operator=(PRead&& other) noexcept {
+        PRead tmp = static_cast<PRead&&>(other);
+        std::swap(file_handle_, tmp.file_handle_);
+        std::swap(file_size_, tmp.file_size_);
+        return *this;
+    }
+    inline ~PRead() noexcept {
+        this->close();
+    }
+
+    [[nodiscard]] auto open(std::filesystem::path const& path) noexcept -> MMapError;
+    // Fills whole dst starting at offset, short read is an error.
+    [[nodiscard]] auto read(std::size_t offset, std::span<char> dst) const noexcept -> MMapError;
+    auto close() noexcept -> void;
+
+    [[nodiscard]] inline auto size() const noexcept {
+        return file_size_;
+    }
+    [[nodiscard]] inline explicit operator bool() const noexcept {
+        return file_handle_ != 0;
+    }
+    [[nodiscard]] inline bool operator!() const noexcept {
+        return file_handle_ == 0;
+    }
+
+private:
+    std::intptr_t file_handle_ = {};
+    std::size_t file_size_ = {};
+};
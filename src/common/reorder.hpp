@@ -0,0 +1,70 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <optional>
+
+// Lets workers finish out of order while results leave in order they were started.
+// At most window results are started and not yet emitted, so memory they hold stays bounded.
+// Unordered mode keeps the bound but emits each result as soon as it is finished.
+template <typename T>
+struct ReorderBuffer {
+    inline ReorderBuffer(std::size_t window, bool ordered) noexcept : window_(window), ordered_(ordered) {}
+    ReorderBuffer(ReorderBuffer const&) = delete;
+    ReorderBuffer& operator=(ReorderBuffer const&) = delete;
+
+    // Waits for room in window and returns sequence number for next result, nullopt once closed.
+    inline std::optional<std::size_t> reserve() {
+        auto lock = std::unique_lock(mutex_);
+        room_.wait(lock, [&] { return closed_ || started_ - emitted_ < window_; });
+        if (closed_) {
+            return std::nullopt;
+        }
+        return started_++;
+    }
+
+    // Hands over finished result, emit runs under lock for every result that is now due.
+    template <typename Emit>
+    inline void finish(std::size_t sequence, T item, Emit&& emit) {
+        auto lock = std::unique_lock(mutex_);
+        if (!ordered_) {
+            ++emitted_;
+            room_.notify_all();
+            emit(item);
+            return;
+        }
+        pending_.emplace(sequence, std::move(item));
+        for (auto i = pending_.begin(); i != pending_.end() && i->first == emitted_; i = pending_.begin()) {
+            auto due = std::move(i->second);
+            pending_.erase(i);
+            ++emitted_;
+            room_.notify_all();
+            emit(due);
+        }
+    }
+
+    // Waits until every started result was emitted or buffer was closed.
+    inline void drain() {
+        auto lock = std::unique_lock(mutex_);
+        room_.wait(lock, [&] { return closed_ || emitted_ == started_; });
+    }
+
+    // Wakes everyone up for good, used when a result will never finish.
+    inline void close() {
+        auto const lock = std::lock_guard(mutex_);
+        closed_ = true;
+        pending_.clear();
+        room_.notify_all();
+    }
+
+private:
+    std::size_t window_;
+    bool ordered_;
+    std::mutex mutex_;
+    std::condition_variable room_;
+    std::map<std::size_t, T> pending_;
+    std::size_t started_ = {};
+    std::size_t emitted_ = {};
+    bool closed_ = false;
+};
@@ -0,0 +1,13 @@
+#include <common/cpu.hpp>
+#include <common/sha2.hpp>
+
+namespace sha2::detail {
+    // Lives in its own translation unit built with sha isa flags, returns false when compiler could not build it.
+    extern bool sha256_blocks_native(uint32_t* state, uint8_t const* data, size_t blocks) noexcept;
+}
+
+bool sha2::detail::sha256_blocks_hw(uint32_t* state, uint8_t const* data, size_t blocks) noexcept {
+    // Zero blocks only probes whether native backend was compiled in
+    static bool const enabled = cpu::has_sha256() && sha256_blocks_native(state, data, 0);
+    return enabled && sha256_blocks_native(state, data, blocks);
+}
@@ -2,8 +2,15 @@
 #define SHA2_HPP
 #include <array>
 #include <cinttypes>
+#include <cstddef>
+#include <type_traits>
 
 namespace sha2 {
+    namespace detail {
+        // Compresses whole blocks with cpu sha instructions, false when unavailable.
+        extern bool sha256_blocks_hw(uint32_t* state, uint8_t const* data, size_t blocks) noexcept;
+    }
+
     template<bool IS512 = false>
     struct SHA2_CTX final {
     private:
@@ -129,10 +136,15 @@ namespace sha2 {
             }
         }
 
-        constexpr void transform() noexcept {
+        constexpr void transform(uint8_t const* block) noexcept {
+            if constexpr (!IS512) {
+                if (!std::is_constant_evaluated() && detail::sha256_blocks_hw(state_.data(), block, 1)) {
+                    return;
+                }
+            }
             uint_t m[K.size()] = {};
             for (size_t i = 0; i != 16; ++i) {
-                READ(buffer_ + i * sizeof(uint_t), m[i]);
+                READ(block + i * sizeof(uint_t), m[i]);
             }
             for (size_t i = 16 ; i != K.size(); ++i) {
                 m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
@@ -174,16 +186,13 @@ namespace sha2 {
                 }
                 data += diff;
                 size -= diff;
-                transform();
+                transform(buffer_);
                 buffer_size_ = 0;
             }
             while (size >= sizeof(buffer_)) {
-                for (size_t i = 0; i != sizeof(buffer_); i++) {
-                    buffer_[i] = data[i];
-                }
+                transform(data);
                 data += sizeof(buffer_);
                 size -= sizeof(buffer_);
-                transform();
             }
             if (size) {
                 for (size_t i = 0; i != size; i++) {
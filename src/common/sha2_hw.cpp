@@ -0,0 +1,97 @@
+#include <common/sha2.hpp>
+#if (defined(__SHA__) && defined(__SSE4_1__)) || (defined(_MSC_VER) && defined(_M_X64))
+#include <immintrin.h>
+#define SHA2_HW_X86
+#elif defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)
+#include <arm_neon.h>
+#define SHA2_HW_ARM
+#endif
+
+namespace sha2::detail {
+    extern bool sha256_blocks_native(uint32_t* state, uint8_t const* data, size_t blocks) noexcept;
+}
+
+#if defined(SHA2_HW_X86) || defined(SHA2_HW_ARM)
+alignas(16) static constexpr uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+#endif
+
+#if defined(SHA2_HW_X86)
+bool sha2::detail::sha256_blocks_native(uint32_t* state, uint8_t const* data, size_t blocks) noexcept {
+    auto const mask = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+    // sha256rnds2 wants state as ABEF and CDGH
+    auto tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(state)), 0xB1);
+    auto state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(state + 4)), 0x1B);
+    auto state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+    for (; blocks; --blocks, data += 64) {
+        auto const abef = state0;
+        auto const cdgh = state1;
+        __m128i msgs[4];
+        for (size_t i = 0; i != 4; ++i) {
+            auto const src = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i * 16));
+            msgs[i] = _mm_shuffle_epi8(src, mask);
+        }
+        for (size_t g = 0; g != 16; ++g) {
+            auto msg = _mm_add_epi32(msgs[g % 4], _mm_load_si128(reinterpret_cast<__m128i const*>(K256 + g * 4)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (g < 12) {
+                auto next = _mm_sha256msg1_epu32(msgs[g % 4], msgs[(g + 1) % 4]);
+                next = _mm_add_epi32(next, _mm_alignr_epi8(msgs[(g + 3) % 4], msgs[(g + 2) % 4], 4));
+                msgs[g % 4] = _mm_sha256msg2_epu32(next, msgs[(g + 3) % 4]);
+            }
+        }
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+    return true;
+}
+#elif defined(SHA2_HW_ARM)
+bool sha2::detail::sha256_blocks_native(uint32_t* state, uint8_t const* data, size_t blocks) noexcept {
+    auto state0 = vld1q_u32(state);
+    auto state1 = vld1q_u32(state + 4);
+    for (; blocks; --blocks, data += 64) {
+        auto const abcd = state0;
+        auto const efgh = state1;
+        uint32x4_t msgs[4];
+        for (size_t i = 0; i != 4; ++i) {
+            msgs[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+        }
+        for (size_t g = 0; g != 16; ++g) {
+            auto const msg = vaddq_u32(msgs[g % 4], vld1q_u32(K256 + g * 4));
+            auto const prev = state0;
+            state0 = vsha256hq_u32(state0, state1, msg);
+            state1 = vsha256h2q_u32(state1, prev, msg);
+            if (g < 12) {
+                auto const next = vsha256su0q_u32(msgs[g % 4], msgs[(g + 1) % 4]);
+                msgs[g % 4] = vsha256su1q_u32(next, msgs[(g + 2) % 4], msgs[(g + 3) % 4]);
+            }
+        }
+        state0 = vaddq_u32(state0, abcd);
+        state1 = vaddq_u32(state1, efgh);
+    }
+    vst1q_u32(state, state0);
+    vst1q_u32(state + 4, state1);
+    return true;
+}
+#else
+bool sha2::detail::sha256_blocks_native(uint32_t*, uint8_t const*, size_t) noexcept {
+    return false;
+}
+#endif
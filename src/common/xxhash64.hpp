@@ -1,8 +1,8 @@
 #pragma once
-#pragma once
 #include <bit>
 #include <cstddef>
 #include <cinttypes>
+#include <cstring>
 #include <string_view>
 
 constexpr uint64_t XXH64(std::u8string_view str, uint64_t seed = 0) noexcept {
@@ -68,3 +68,110 @@ constexpr uint64_t XXH64(std::u8string_view str, uint64_t seed = 0) noexcept {
     result ^= result >> 32;
     return result;
 }
+
+// Streaming XXH64 over raw bytes, unlike XXH64 above input is not lowercased.
+struct XXH64_stream {
+    inline constexpr XXH64_stream(uint64_t seed = 0) noexcept
+        : state_ { seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1 }, seed_(seed)
+    {}
+
+    inline void update(void const* data, std::size_t size) noexcept {
+        auto src = static_cast<unsigned char const*>(data);
+        total_ += size;
+        if (buffer_size_ + size < 32) {
+            std::memcpy(buffer_ + buffer_size_, src, size);
+            buffer_size_ += size;
+            return;
+        }
+        if (buffer_size_) {
+            auto const fill = 32 - buffer_size_;
+            std::memcpy(buffer_ + buffer_size_, src, fill);
+            round4(buffer_);
+            src += fill;
+            size -= fill;
+            buffer_size_ = 0;
+        }
+        while (size >= 32) {
+            round4(src);
+            src += 32;
+            size -= 32;
+        }
+        std::memcpy(buffer_, src, size);
+        buffer_size_ = size;
+    }
+
+    inline uint64_t digest() const noexcept {
+        auto result = uint64_t{};
+        if (total_ >= 32) {
+            auto const& s = state_;
+            result = std::rotl(s[0], 1) + std::rotl(s[1], 7) + std::rotl(s[2], 12) + std::rotl(s[3], 18);
+            for (auto v: s) {
+                result ^= round(0, v);
+                result = result * Prime1 + Prime4;
+            }
+        } else {
+            result = seed_ + Prime5;
+        }
+        result += total_;
+        auto src = buffer_;
+        auto size = buffer_size_;
+        while (size >= 8) {
+            result ^= round(0, read64(src));
+            result = std::rotl(result, 27) * Prime1 + Prime4;
+            src += 8;
+            size -= 8;
+        }
+        if (size >= 4) {
+            result ^= static_cast<uint64_t>(read32(src)) * Prime1;
+            result = std::rotl(result, 23) * Prime2 + Prime3;
+            src += 4;
+            size -= 4;
+        }
+        while (size) {
+            result ^= *src * Prime5;
+            result = std::rotl(result, 11) * Prime1;
+            src += 1;
+            size -= 1;
+        }
+        result ^= result >> 33;
+        result *= Prime2;
+        result ^= result >> 29;
+        result *= Prime3;
+        result ^= result >> 32;
+        return result;
+    }
+private:
+    static constexpr std::uint64_t Prime1 = 11400714785074694791U;
+    static constexpr std::uint64_t Prime2 = 14029467366897019727U;
+    static constexpr std::uint64_t Prime3 =  1609587929392839161U;
+    static constexpr std::uint64_t Prime4 =  9650029242287828579U;
+    static constexpr std::uint64_t Prime5 =  2870177450012600261U;
+
+    uint64_t state_[4];
+    uint64_t seed_;
+    uint64_t total_ = {};
+    unsigned char buffer_[32] = {};
+    std::size_t buffer_size_ = {};
+
+    static inline uint64_t read64(unsigned char const* src) noexcept {
+        uint64_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return value;
+    }
+
+    static inline uint32_t read32(unsigned char const* src) noexcept {
+        uint32_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return value;
+    }
+
+    static inline uint64_t round(uint64_t acc, uint64_t input) noexcept {
+        return std::rotl(acc + input * Prime2, 31) * Prime1;
+    }
+
+    inline void round4(unsigned char const* src) noexcept {
+        for (std::size_t i = 0; i != 4; ++i) {
+            state_[i] = round(state_[i], read64(src + i * 8));
+        }
+    }
+};
@@ -1,6 +1,8 @@
 #include <common/bt_error.hpp>
 #include <common/mmap.hpp>
 #include <common/magic.hpp>
+#include <common/mbhash.hpp>
+#include <common/xxhash64.hpp>
 #include <file/base.hpp>
 #include <file/raw.hpp>
 #include <file/rlsm.hpp>
@@ -42,31 +44,188 @@ IReader::~IReader() = default;
 
 IManager::~IManager() = default;
 
+void IManager::extract(std::span<ExtractJob const> jobs, [[maybe_unused]] std::size_t threads) {
+    for (auto const& job: jobs) {
+        job.file->extract_to(job.path);
+    }
+}
+
+std::u8string IFile::content_id() const {
+    return {};
+}
+
+bool IFile::shares_checksums() const {
+    return false;
+}
+
 void IFile::extract_to(fs::path const& file_path) {
     bt_trace(u8"file_path: {}", file_path.generic_u8string());
     bt_rethrow(fs::create_directories(file_path.parent_path()));
     auto in_file = open();
     auto in_data = in_file->read();
+    // Output of earlier run may be hardlinked to other files, writing into it would change them too
+    bt_rethrow(fs::remove(file_path));
     auto out_file = MMap<char>{};
     bt_rethrow(out_file.create(file_path, in_data.size()).unwrap());
     std::memcpy(out_file.data(), in_data.data(), in_data.size());
 }
 
-Checksums IFile::checksums() {
+void IFile::stream(std::function<void(std::span<char const>)> const& sink) {
+    constexpr std::size_t const BLOCK_SIZE = 1024 * 1024;
+    auto reader = open();
+    auto const total = reader->size();
+    for (std::size_t offset = 0; offset != total;) {
+        auto const size = std::min(BLOCK_SIZE, total - offset);
+        sink(reader->read(offset, size));
+        offset += size;
+    }
+}
+
+namespace {
+    // Slices are small enough to still be in cache when next digest reads them
+    struct StreamDigest {
+        static constexpr std::size_t const SLICE_SIZE = 64 * 1024;
+        digestpp::md5 md5 = {};
+        digestpp::sha1 sha1 = {};
+        XXH64_stream xxh64 = {};
+        bool with_xxh64;
+
+        void absorb(std::span<char const> data) {
+            while (!data.empty()) {
+                auto const slice = data.first(std::min(SLICE_SIZE, data.size()));
+                md5.absorb(slice.data(), slice.size());
+                sha1.absorb(slice.data(), slice.size());
+                if (with_xxh64) {
+                    xxh64.update(slice.data(), slice.size());
+                }
+                data = data.subspan(slice.size());
+            }
+        }
+
+        void finish(Checksums& results) {
+            results.list[u8"md5"] = md5.hexdigest();
+            results.list[u8"sha1"] = sha1.hexdigest();
+            if (with_xxh64) {
+                results.list[u8"xxh64"] = fmt::format("{:016x}", xxh64.digest());
+            }
+        }
+    };
+}
+
+Checksums IFile::checksums(bool with_xxh64) {
     auto results = Checksums{};
     if (auto link = get_link(); link.empty()) {
-        auto reader = open();
-        auto const data = reader->read();
-        results.list[u8"md5"] = digestpp::md5().absorb(data.data(), data.size()).hexdigest();
-        results.list[u8"sha1"] = digestpp::sha1().absorb(data.data(), data.size()).hexdigest();
+        auto digest = StreamDigest { .with_xxh64 = with_xxh64 };
+        stream([&](std::span<char const> data) { digest.absorb(data); });
+        digest.finish(results);
     } else {
         results.list[u8"link"] = {link.begin(), link.end()};
     }
     return results;
 }
 
+Checksums IFile::extract_checksums(fs::path const& file_path, bool with_xxh64) {
+    bt_trace(u8"file_path: {}", file_path.generic_u8string());
+    bt_rethrow(fs::create_directories(file_path.parent_path()));
+    bt_rethrow(fs::remove(file_path));
+    auto out_file = MMap<char>{};
+    bt_rethrow(out_file.create(file_path, size()).unwrap());
+    auto digest = StreamDigest { .with_xxh64 = with_xxh64 };
+    auto offset = std::size_t{};
+    stream([&](std::span<char const> data) {
+        bt_assert(data.size() <= out_file.size() - offset);
+        std::memcpy(out_file.data() + offset, data.data(), data.size());
+        offset += data.size();
+        digest.absorb(data);
+    });
+    bt_assert(offset == out_file.size());
+    auto results = Checksums{};
+    digest.finish(results);
+    return results;
+}
+
+std::vector<Checksums> IFile::checksums_batch(std::span<std::shared_ptr<IFile> const> files, bool with_xxh64) {
+    auto batch = ChecksumBatch::read(files, with_xxh64);
+    batch.digest();
+    return std::move(batch.results);
+}
+
+ChecksumBatch ChecksumBatch::read(std::span<std::shared_ptr<IFile> const> files, bool with_xxh64,
+                                  std::span<fs::path const> outputs) {
+    // Bigger files gain nothing from lanes and would only pin memory
+    constexpr std::size_t const LANE_FILE_SIZE = 1024 * 1024;
+    // Past this files are streamed right away instead of being held whole until digest
+    constexpr std::size_t const WHOLE_FILE_SIZE = 32 * 1024 * 1024;
+    auto batch = ChecksumBatch{};
+    batch.results.resize(files.size());
+    batch.with_xxh64_ = with_xxh64;
+    for (std::size_t i = 0; i != files.size(); ++i) {
+        auto const& file = files[i];
+        auto const size = file->size();
+        if (!file->get_link().empty() || size > WHOLE_FILE_SIZE || file->shares_checksums()) {
+            auto const has_output = !outputs.empty() && !outputs[i].empty();
+            if (size > WHOLE_FILE_SIZE && has_output) {
+                batch.results[i] = file->extract_checksums(outputs[i], with_xxh64);
+                continue;
+            }
+            if (has_output && file->shares_checksums()) {
+                // Decoded data stays with batch, so output is written from it instead of decoding again
+                auto reader = file->open();
+                batch.bytes_ += reader->size();
+                batch.readers_.push_back(std::move(reader));
+            }
+            batch.results[i] = file->checksums(with_xxh64);
+            continue;
+        }
+        auto reader = file->open();
+        auto message = Message { i, reader->read() };
+        batch.bytes_ += message.data.size();
+        (size > LANE_FILE_SIZE ? batch.whole_ : batch.lanes_).push_back(message);
+        batch.readers_.push_back(std::move(reader));
+    }
+    return batch;
+}
+
+void ChecksumBatch::digest() {
+    auto const to_hex = [](std::span<std::uint8_t const> data) {
+        auto result = std::string{};
+        for (auto const c: data) {
+            result += "0123456789abcdef"[c >> 4];
+            result += "0123456789abcdef"[c & 15];
+        }
+        return result;
+    };
+    auto messages = std::vector<std::span<char const>>{};
+    messages.reserve(lanes_.size());
+    for (auto const& message: lanes_) {
+        messages.push_back(message.data);
+    }
+    auto digests = std::vector<mbhash::Digest>(messages.size());
+    mbhash::md5_sha1(messages, digests);
+    for (std::size_t j = 0; j != messages.size(); ++j) {
+        auto& result = results[lanes_[j].index];
+        result.list[u8"md5"] = to_hex(digests[j].md5);
+        result.list[u8"sha1"] = to_hex(digests[j].sha1);
+        if (with_xxh64_) {
+            auto xxh64 = XXH64_stream();
+            xxh64.update(messages[j].data(), messages[j].size());
+            result.list[u8"xxh64"] = fmt::format("{:016x}", xxh64.digest());
+        }
+    }
+    for (auto const& message: whole_) {
+        auto digest = StreamDigest { .with_xxh64 = with_xxh64_ };
+        digest.absorb(message.data);
+        digest.finish(results[message.index]);
+    }
+    lanes_.clear();
+    whole_.clear();
+    readers_.clear();
+    bytes_ = 0;
+}
 
-std::shared_ptr<IManager> IManager::make(fs::path src, fs::path cdn, std::u8string remote, std::set<std::u8string> const& langs) {
+std::shared_ptr<IManager> IManager::make(fs::path src, fs::path cdn, std::u8string remote, bool ranged,
+                                         bool compressed, std::uint64_t quota,
+                                         std::set<std::u8string> const& langs) {
     bt_trace(u8"src: {}", src.generic_u8string());
     bt_trace(u8"cdn: {}", cdn.generic_u8string());
     bt_assert(fs::exists(src));
@@ -104,7 +263,7 @@ std::shared_ptr<IManager> IManager::make(fs::path src, fs::path cdn, std::u8stri
             bt_rethrow(fs::create_directories(cdn));
         }
         cdn = fs::absolute(cdn);
-        return std::make_shared<ManagerRMAN>(file, cdn, remote, langs, nullptr);
+        return std::make_shared<ManagerRMAN>(file, cdn, remote, ranged, compressed, quota, langs, nullptr);
     } else if (magic == u8".wad") {
         if (cdn.empty()) {
             //    <.>
@@ -2,6 +2,7 @@
 #include <common/fs.hpp>
 #include <common/string.hpp>
 #include <cinttypes>
+#include <functional>
 #include <memory>
 #include <map>
 #include <set>
@@ -55,12 +56,51 @@ namespace file {
         virtual std::u8string get_link() = 0;
         virtual std::size_t size() const = 0;
         virtual std::u8string id() const = 0;
+        // Key that only files with same bytes share, derived from metadata without reading data, empty if unknown.
+        virtual std::u8string content_id() const;
         virtual std::shared_ptr<Location> location() const = 0;
         virtual std::shared_ptr<IReader> open() = 0;
         virtual bool is_wad() = 0;
-        Checksums checksums();
+        virtual void stream(std::function<void(std::span<char const>)> const& sink);
+        virtual Checksums checksums(bool with_xxh64 = false);
+        // True when checksums() answers from cache shared with other files, batches ask it instead of hashing.
+        virtual bool shares_checksums() const;
+
+        // Small files are hashed side by side in simd lanes, results are in order of files.
+        static std::vector<Checksums> checksums_batch(std::span<std::shared_ptr<IFile> const> files,
+                                                      bool with_xxh64 = false);
 
         void extract_to(fs::path const& file_path);
+        // Writes file out while hashing it, so data is only decoded once for both.
+        Checksums extract_checksums(fs::path const& file_path, bool with_xxh64 = false);
+    };
+
+    // Checksum batch split in two, read() touches files and stays on thread that traverses them,
+    // digest() only hashes what was read so different batches can be digested on any thread.
+    struct ChecksumBatch {
+        std::vector<Checksums> results;
+
+        // Files too big to hold until digest are written to their non empty output path while being hashed.
+        static ChecksumBatch read(std::span<std::shared_ptr<IFile> const> files, bool with_xxh64 = false,
+                                  std::span<fs::path const> outputs = {});
+
+        void digest();
+
+        // Bytes of file data batch keeps alive until digested.
+        std::size_t bytes() const noexcept {
+            return bytes_;
+        }
+
+    private:
+        struct Message {
+            std::size_t index;
+            std::span<char const> data;
+        };
+        std::vector<std::shared_ptr<IReader>> readers_;
+        std::vector<Message> lanes_;
+        std::vector<Message> whole_;
+        std::size_t bytes_ = {};
+        bool with_xxh64_ = {};
     };
 
     struct IManager {
@@ -72,6 +112,16 @@ namespace file {
         virtual ~IManager() = 0;
         virtual std::vector<std::shared_ptr<IFile>> list() = 0;
 
-        static std::shared_ptr<IManager> make(fs::path src, fs::path cdn, std::u8string remote, std::set<std::u8string> const& langs);
+        struct ExtractJob {
+            std::shared_ptr<IFile> file;
+            fs::path path;
+        };
+
+        // Writes files from list() to their paths, managers may overlap reading and writing across threads.
+        virtual void extract(std::span<ExtractJob const> jobs, std::size_t threads);
+
+        static std::shared_ptr<IManager> make(fs::path src, fs::path cdn, std::u8string remote, bool ranged,
+                                              bool compressed, std::uint64_t quota,
+                                              std::set<std::u8string> const& langs);
     };
 }
@@ -3,6 +3,7 @@
 #include <common/xxhash64.hpp>
 #include <common/magic.hpp>
 #include <file/hashlist.hpp>
+#include <algorithm>
 #include <optional>
 #include <charconv>
 #include <vector>
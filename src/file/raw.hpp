@@ -16,6 +16,7 @@ namespace file {
         std::shared_ptr<Location> location() const override;
         std::shared_ptr<IReader> open() override;
         bool is_wad() override;
+        inline fs::path const& path() const noexcept { return path_; }
 
         static std::shared_ptr<IReader> make_reader(fs::path const& path);
     private:
@@ -1,9 +1,12 @@
 #include <common/bt_error.hpp>
 #include <common/mmap.hpp>
+#include <common/xxhash64.hpp>
 #include <file/hashlist.hpp>
 #include <file/raw.hpp>
 #include <file/rlsm.hpp>
+#include <file/rlsm/filecache.hpp>
 #include <file/rlsm/manifest.hpp>
+#include <algorithm>
 
 using namespace file;
 
@@ -68,6 +71,10 @@ std::u8string FileRLSM::id() const {
     return fmt::format(u8"{}.md5", result);
 }
 
+std::u8string FileRLSM::content_id() const {
+    return id();
+}
+
 std::shared_ptr<Location> FileRLSM::location() const {
     return location_;
 }
@@ -92,11 +99,29 @@ ManagerRLSM::ManagerRLSM(std::shared_ptr<IReader> source,
                          std::shared_ptr<Location> source_location)
     : location_(std::make_shared<Location>(source_location))
 {
-    auto manifest = rlsm::RLSMManifest::read(source->read());
-    auto const& project_name = manifest.names[manifest.header.project_name];
-    base_ = cdn / u8"projects" / project_name;
-    location_->path = fs::path("projects") / project_name / u8"releases" / manifest.header.release_version.string() / "releasemanifest";
-    files_ = manifest.list_files();
+    // Hashing bytes is far cheaper than parsing them, cache is only missed for new manifests
+    auto const data = source->read();
+    auto checksum = XXH64_stream();
+    checksum.update(data.data(), data.size());
+    auto const cache_path = cdn / u8"manifests" / fmt::format(u8"{:016X}.rlsm.filecache", checksum.digest());
+    auto cached = rlsm::FileCache::read(cache_path, checksum.digest());
+    if (!cached) {
+        auto manifest = rlsm::RLSMManifest::read(data);
+        cached = rlsm::FileCache {
+            manifest.names[manifest.header.project_name],
+            manifest.header.release_version,
+            manifest.list_files(),
+        };
+        // Cache is best effort, mirror might be read only
+        try {
+            cached->write(cache_path, checksum.digest());
+        } catch (std::exception const&) {
+            bt::error_stack().clear();
+        }
+    }
+    base_ = cdn / u8"projects" / cached->project_name;
+    location_->path = fs::path("projects") / cached->project_name / u8"releases" / cached->version.string() / "releasemanifest";
+    files_ = std::move(cached->files);
     (void)langs;
 }
 
@@ -15,6 +15,7 @@ namespace file {
         std::u8string get_link() override;
         std::size_t size() const override;
         std::u8string id() const override;
+        std::u8string content_id() const override;
         std::shared_ptr<Location> location() const override;
         std::shared_ptr<IReader> open() override;
         bool is_wad() override;
@@ -0,0 +1,68 @@
+#include <common/binfile.hpp>
+#include <common/bt_error.hpp>
+#include <common/mmap.hpp>
+#include <file/rlsm/filecache.hpp>
+#include <algorithm>
+
+using namespace rlsm;
+
+static constexpr auto CACHE_MAGIC = std::array { 'R', 'L', 'F', 'C' };
+static constexpr auto CACHE_VERSION = std::uint32_t{2};
+
+std::optional<FileCache> FileCache::read(fs::path const& path, std::uint64_t checksum) {
+    if (!fs::exists(path)) {
+        return std::nullopt;
+    }
+    auto file = MMap<char const>{};
+    if (file.open(path)) {
+        return std::nullopt;
+    }
+    auto reader = BinReader { file.span() };
+    auto magic = std::array<char, 4>{};
+    auto cache_version = std::uint32_t{};
+    auto cache_checksum = std::uint64_t{};
+    auto result = FileCache{};
+    if (!reader.read(magic) || magic != CACHE_MAGIC) {
+        return std::nullopt;
+    }
+    if (!reader.read(cache_version) || cache_version != CACHE_VERSION) {
+        return std::nullopt;
+    }
+    if (!reader.read(cache_checksum) || cache_checksum != checksum) {
+        return std::nullopt;
+    }
+    if (!reader.read(result.project_name) || !reader.read(result.version)) {
+        return std::nullopt;
+    }
+    auto file_count = std::uint32_t{};
+    if (!reader.read(file_count)) {
+        return std::nullopt;
+    }
+    auto& files = result.files;
+    files.reserve(std::min(file_count, static_cast<std::uint32_t>(reader.data.size() / sizeof(RLSMFile))));
+    for (std::uint32_t i = 0; i != file_count; ++i) {
+        auto& file_info = files.emplace_back();
+        if (!reader.read(static_cast<RLSMFile&>(file_info)) || !reader.read(file_info.name)) {
+            return std::nullopt;
+        }
+    }
+    if (!reader.data.empty()) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+void FileCache::write(fs::path const& path, std::uint64_t checksum) const {
+    auto writer = BinWriter{};
+    writer.write(CACHE_MAGIC);
+    writer.write(CACHE_VERSION);
+    writer.write(checksum);
+    writer.write(project_name);
+    writer.write(version);
+    writer.write(static_cast<std::uint32_t>(files.size()));
+    for (auto const& file_info: files) {
+        writer.write(static_cast<RLSMFile const&>(file_info));
+        writer.write(file_info.name);
+    }
+    writer.save(path);
+}
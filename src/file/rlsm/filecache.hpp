@@ -0,0 +1,16 @@
+#pragma once
+#include <common/fs.hpp>
+#include <file/rlsm/manifest.hpp>
+#include <optional>
+
+namespace rlsm {
+    // Keyed by checksum of releasemanifest bytes, so cache is found without parsing manifest.
+    struct FileCache {
+        std::u8string project_name;
+        RLSMVersion version;
+        std::vector<FileInfo> files;
+
+        static std::optional<FileCache> read(fs::path const& path, std::uint64_t checksum);
+        void write(fs::path const& path, std::uint64_t checksum) const;
+    };
+}
@@ -1,23 +1,36 @@
 #include <zstd.h>
 
 #include <common/bt_error.hpp>
+#include <common/filelock.hpp>
 #include <common/mmap.hpp>
+#include <common/pfile.hpp>
+#include <common/pread.hpp>
+#include <common/queue.hpp>
+#include <common/xxhash64.hpp>
 #include <file/hashlist.hpp>
 #include <file/raw.hpp>
 #include <file/rman.hpp>
+#include <file/rman/bundleindex.hpp>
+#include <file/rman/cacheusage.hpp>
+#include <file/rman/chunkstore.hpp>
+#include <file/rman/diff.hpp>
+#include <file/rman/download.hpp>
+#include <file/rman/filecache.hpp>
 #include <file/rman/manifest.hpp>
-#ifndef NOMINMAX
-#define NOMINMAX
-#endif
-#ifndef WIN32_LEAN_AND_MEAN
-#define WIN32_LEAN_AND_MEAN
-#endif
-#include <curl/curl.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace file;
 
 struct file::CacheRMAN final  {
-    CacheRMAN(fs::path cdn, std::u8string remote) : cdn_(std::move(cdn)), remote_(std::move(remote)) {
+    CacheRMAN(fs::path cdn, std::u8string remote, bool ranged, bool compressed, std::uint64_t quota)
+        : cdn_(std::move(cdn)), remote_(std::move(remote)), ranged_(ranged), compressed_(compressed), quota_(quota)
+    {
         bt_assert(!cdn_.empty());
 
         auto cdn_str = cdn_.generic_u8string();
@@ -32,13 +45,28 @@ struct file::CacheRMAN final  {
             cdn_ /= u8"bundles";
         }
 
+        if (is_chunking_) {
+            store_ = std::make_unique<rman::ChunkStore>(cdn_ / u8"packs");
+            // Chunk index only refreshes access times this stale, anything newer counts as used by us
+            session_start_ -= rman::ChunkStore::TOUCH_INTERVAL;
+        } else {
+            usage_ = std::make_unique<rman::CacheUsage>(cdn_);
+        }
+
         if (!remote_.empty()) {
             bt_rethrow(fs::create_directories(cdn_));
-            bt_assert(curl_ = curl_easy_init());
-            bt_assert(curl_easy_setopt(curl_, CURLOPT_VERBOSE, 0) == CURLE_OK);
-            bt_assert(curl_easy_setopt(curl_, CURLOPT_NOPROGRESS, 1L) == CURLE_OK);
-            curl_easy_setopt(curl_, CURLOPT_WRITEDATA, this);
-            curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &write_remote_bundle);
+            download_ = std::make_unique<rman::Download>();
+        }
+    }
+
+    ~CacheRMAN() {
+        // Quota is best effort, mirror might be read only
+        if (quota_) {
+            try {
+                collect(false, quota_, std::max(std::thread::hardware_concurrency(), 1u));
+            } catch (std::exception const&) {
+                bt::error_stack().clear();
+            }
         }
     }
 
@@ -47,113 +75,463 @@ struct file::CacheRMAN final  {
         if (remote_chunk_id == chunk.id) return remote_chunk_buffer;
         if (local_chunk_id == chunk.id) return local_chunk_file.span();
 
-        // Try to open local chunk cache
+        if (auto stored = open_stored_chunk(chunk)) {
+            if (!stored->compressed) {
+                return stored->data;
+            }
+            decompress_chunk(chunk.id, chunk.uncompressed_size, stored->data);
+            return remote_chunk_buffer;
+        }
+        auto is_ranged = false;
+        auto const fetched = fetch_chunk(chunk, is_ranged);
+        if (!fetched.compressed) {
+            return fetched.data;
+        }
+        decompress_chunk(chunk.id, chunk.uncompressed_size, fetched.data);
+        if (is_ranged && is_chunking_ && !compressed_) {
+            store_->put(chunk.id, remote_chunk_buffer);
+        }
+        return remote_chunk_buffer;
+    }
+
+    // Copies chunk bytes into out for decompression elsewhere, returns true when out holds zstd frame.
+    bool load_chunk(rman::FileChunk const& chunk, std::vector<char>& out) {
+        if (auto stored = open_stored_chunk(chunk)) {
+            out.assign(stored->data.begin(), stored->data.end());
+            return stored->compressed;
+        }
+        auto is_ranged = false;
+        auto const fetched = fetch_chunk(chunk, is_ranged);
+        if (fetched.compressed && is_ranged && is_chunking_ && !compressed_) {
+            decompress_chunk(chunk.id, chunk.uncompressed_size, fetched.data);
+            store_->put(chunk.id, remote_chunk_buffer);
+            out.assign(remote_chunk_buffer.begin(), remote_chunk_buffer.end());
+            return false;
+        }
+        out.assign(fetched.data.begin(), fetched.data.end());
+        return fetched.compressed;
+    }
+
+    // Try to open local chunk cache, packs first then loose chunk files from older caches
+    std::optional<rman::ChunkStore::Chunk> open_stored_chunk(rman::FileChunk const& chunk) {
+        if (!is_chunking_) {
+            return std::nullopt;
+        }
+        if (auto stored = store_->get(chunk.id)) {
+            return stored;
+        }
+        auto local_chunk_path = cdn_ / fmt::format(u8"{:016X}.chunk", chunk.id);
+        if (fs::exists(local_chunk_path)) {
+            local_chunk_id = {};
+            bt_rethrow(local_chunk_file.open(local_chunk_path).unwrap());
+            local_chunk_id = chunk.id;
+            return rman::ChunkStore::Chunk { local_chunk_file.span(), false };
+        }
+        bt_assert(download_ && "Local chunk missing and no remote to fallback to!");
+        return std::nullopt;
+    }
+
+    // Chunk bytes from local bundles or remote, valid until next fetch.
+    rman::ChunkStore::Chunk fetch_chunk(rman::FileChunk const& chunk, bool& is_ranged) {
+        // In ranged mode only fetch the compressed bytes of this chunk instead of whole bundle
+        auto const local = find_local_chunk(chunk);
+        is_ranged = !local && ranged_ && !has_bundle(chunk.bundle_id);
+        if (is_ranged && fetch_range(chunk)) {
+            // Ranged fetches never see the whole bundle so store the chunk by itself
+            if (is_chunking_ && compressed_) {
+                store_->put(chunk.id, read_buffer, true);
+            }
+            return { read_buffer, true };
+        }
+        is_ranged = false;
+        if (is_chunking_) {
+            // Whole bundle lands in chunk store, maybe by another process we waited on
+            download_bundle(chunk);
+            auto stored = store_->get(chunk.id);
+            bt_assert(stored && "Bundle did not contain chunk");
+            return *stored;
+        }
+        return { read_bundle_range(local ? *local : chunk), true };
+    }
+
+    // Local bundles only have the chunk's compressed bytes read, without mapping whole bundle.
+    std::span<char const> read_bundle_range(rman::FileChunk const& chunk) {
+        auto file = open_local_bundle(chunk.bundle_id);
+        if (!file) {
+            download_bundle(chunk);
+            file = open_local_bundle(chunk.bundle_id);
+            bt_assert(file);
+        }
+        bt_assert(chunk.compressed_size + chunk.compressed_offset <= file->size());
+        read_buffer.resize(chunk.compressed_size);
+        bt_rethrow(file->read(chunk.compressed_offset, read_buffer).unwrap());
+        return read_buffer;
+    }
+
+    PRead const* open_local_bundle(rman::BundleID bundle_id) {
         if (is_chunking_) {
-            auto local_chunk_path = cdn_ / fmt::format(u8"{:016X}.chunk", chunk.id);
-            if (fs::exists(local_chunk_path)) {
-                local_chunk_id = {};
-                bt_rethrow(local_chunk_file.open(local_chunk_path).unwrap());
-                local_chunk_id = chunk.id;
-                return local_chunk_file.span();
+            return nullptr;
+        }
+        auto i = std::find_if(local_bundle_files.begin(), local_bundle_files.end(),
+                              [&](auto const& kvp) { return kvp.first == bundle_id; });
+        if (i != local_bundle_files.end()) {
+            std::rotate(local_bundle_files.begin(), i, i + 1);
+            return &local_bundle_files.front().second;
+        }
+        auto local_bundle_path = cdn_ / fmt::format(u8"{:016X}.bundle", bundle_id);
+        if (!fs::exists(local_bundle_path)) {
+            return nullptr;
+        }
+        auto file = PRead{};
+        bt_rethrow(file.open(local_bundle_path).unwrap());
+        usage_->touch(bundle_id);
+        if (local_bundle_files.size() == MAX_OPEN_BUNDLES) {
+            local_bundle_files.pop_back();
+        }
+        local_bundle_files.emplace(local_bundle_files.begin(), bundle_id, std::move(file));
+        return &local_bundle_files.front().second;
+    }
+
+    // Remote bundle is streamed to disk through staging file and is never held in memory whole.
+    // Chunk caches split it into chunk store and drop staging file.
+    // Only one process downloads a bundle, others wait for it and then find it cached.
+    void download_bundle(rman::FileChunk const& chunk) {
+        auto const bundle_id = chunk.bundle_id;
+        bt_trace(u8"bundle: {:016X}", bundle_id);
+        bt_assert(download_ && "Local bundle missing and no remote to fallback to!");
+        auto lock = lock_bundle(bundle_id);
+        if (is_chunking_ ? store_->contains(chunk.id) : has_bundle(bundle_id)) {
+            lock.unlock(true);
+            return;
+        }
+        auto const path = bundle_path(bundle_id);
+        auto const part_path = fs::path(path) += u8".part";
+        download_->fetch(bundle_url(bundle_id), part_path);
+        auto rbun = rman::RBUNBundle{};
+        auto size = std::size_t{};
+        {
+            auto file = MMap<char const>{};
+            bt_rethrow(file.open(part_path).unwrap());
+            try {
+                rbun = rman::RBUNBundle::read(file.span());
+                bt_assert(rbun.id == bundle_id);
+                auto expected = sizeof(rman::RBUNFooter) + rbun.chunks.size() * sizeof(rman::RBUNChunk);
+                for (auto const& chunk: rbun.chunks) {
+                    expected += chunk.compressed_size;
+                }
+                bt_assert(expected == file.size());
+            } catch (std::exception const&) {
+                // Resuming corrupt data would never succeed, start over next time
+                file = {};
+                auto error = std::error_code{};
+                fs::remove(part_path, error);
+                throw;
+            }
+            size = file.size();
+            if (is_chunking_) {
+                store_bundle_chunks(rbun, file.span(), dctx_.get(), read_buffer);
+            }
+        }
+        if (is_chunking_) {
+            bt_rethrow(fs::remove(part_path));
+        } else {
+            bt_rethrow(fs::rename(part_path, path));
+            usage_->touch(bundle_id);
+            if (index_) {
+                index_->add(bundle_id, size, rbun.chunks);
             }
-            bt_assert(curl_ && "Local chunk missing and no remote to fallback to!");
         }
-        auto bundle = open_bundle(chunk);
-        bt_assert(chunk.compressed_size + chunk.compressed_offset <= bundle.size());
+        lock.unlock(true);
+    }
+
+    // In flight marker next to bundle, held while its part file is written.
+    // Lock dies with a crashed holder, whoever takes it next resumes the part file.
+    FileLock lock_bundle(rman::BundleID bundle_id) const {
+        auto result = FileLock{};
+        bt_rethrow(result.lock(fs::path(bundle_path(bundle_id)) += u8".lock").unwrap());
+        return result;
+    }
+
+    fs::path const& path() const noexcept {
+        return cdn_;
+    }
+
+    bool is_chunking() const noexcept {
+        return is_chunking_;
+    }
+
+    rman::ChunkStore* store() const noexcept {
+        return store_.get();
+    }
+
+    void decompress_chunk(rman::ChunkID chunk_id, std::size_t uncompressed_size, std::span<char const> src) {
         remote_chunk_id = {};
         remote_chunk_buffer.clear();
-        remote_chunk_buffer.resize(chunk.uncompressed_size);
-        auto result = ZSTD_decompress(remote_chunk_buffer.data(), remote_chunk_buffer.size(),
-                                      bundle.data() + chunk.compressed_offset, chunk.compressed_size);
+        remote_chunk_buffer.resize(uncompressed_size);
+        auto result = ZSTD_decompressDCtx(dctx_.get(), remote_chunk_buffer.data(), remote_chunk_buffer.size(),
+                                          src.data(), src.size());
         bt_trace("zstd error: {}", ZSTD_getErrorName(result));
         bt_assert(!ZSTD_isError(result));
-        bt_assert(result == chunk.uncompressed_size);
-        remote_chunk_id = chunk.id;
-        return remote_chunk_buffer;
+        bt_assert(result == uncompressed_size);
+        remote_chunk_id = chunk_id;
     }
 
-    std::span<char const> open_bundle(rman::FileChunk const& chunk) {
-        // If we already have bundle in our last use cache, use it
-        if (remote_bundle_id == chunk.bundle_id) return remote_bundle_buffer;
-        if (local_bundle_id == chunk.bundle_id) return local_bundle_file.span();
+    // Same chunk often sits in another local bundle from an older patch.
+    std::optional<rman::FileChunk> find_local_chunk(rman::FileChunk const& chunk) {
+        if (is_chunking_ || has_bundle(chunk.bundle_id)) {
+            return std::nullopt;
+        }
+        if (!index_) {
+            index_ = std::make_unique<rman::BundleIndex>(cdn_);
+            index_->refresh();
+        }
+        // Bundle may have been collected by another process since index was refreshed, try other copies
+        for (auto const& location: index_->find(chunk.id)) {
+            if (location.uncompressed_size != chunk.uncompressed_size || !has_bundle(location.bundle_id)) {
+                continue;
+            }
+            auto result = chunk;
+            result.bundle_id = location.bundle_id;
+            result.compressed_offset = location.compressed_offset;
+            result.compressed_size = location.compressed_size;
+            return result;
+        }
+        return std::nullopt;
+    }
 
-        // Try to open local bundle
-        auto local_bundle_path = cdn_ / fmt::format(u8"{:016X}.bundle", chunk.bundle_id);
-        if (!is_chunking_) {
-            if (fs::exists(local_bundle_path)) {
-                local_bundle_id = {};
-                bt_rethrow(local_bundle_file.open(local_bundle_path).unwrap());
-                local_bundle_id = chunk.bundle_id;
-                return local_bundle_file.span();
+    bool has_bundle(rman::BundleID bundle_id) const {
+        for (auto const& [open_id, file]: local_bundle_files) {
+            if (open_id == bundle_id) {
+                return true;
             }
         }
+        if (is_chunking_) {
+            return false;
+        }
+        return fs::exists(cdn_ / fmt::format(u8"{:016X}.bundle", bundle_id));
+    }
 
-        // Fetch remote bundle buffer
-        bt_assert(curl_ && "Local bundle missing and no remote to fallback to!");
-        remote_bundle_id = {};
-        remote_bundle_buffer.clear();
-        auto remote_path = remote_ + fmt::format(u8"/bundles/{:016X}.bundle", chunk.bundle_id);
-        curl_easy_setopt(curl_, CURLOPT_URL, (char const*)(remote_path.c_str()));
-        bt_assert(curl_easy_perform(curl_) == CURLE_OK);
+    // Fills read_buffer with compressed chunk, false when server does not serve ranges.
+    bool fetch_range(rman::FileChunk const& chunk) {
+        bt_trace(u8"bundle: {:016X}", chunk.bundle_id);
+        bt_assert(download_ && "Local bundle missing and no remote to fallback to!");
+        bt_assert(chunk.compressed_size != 0);
+        return download_->fetch_range(bundle_url(chunk.bundle_id), chunk.compressed_offset, chunk.compressed_size,
+                                      read_buffer);
+    }
 
-        auto rbun = rman::RBUNBundle::read(remote_bundle_buffer);
-        bt_assert(rbun.id == chunk.bundle_id);
-        remote_bundle_id = chunk.bundle_id;
+    fs::path bundle_path(rman::BundleID bundle_id) const {
+        return cdn_ / fmt::format(u8"{:016X}.bundle", bundle_id);
+    }
 
-        // Write remote bundle or chunks to local filesystem
+    std::u8string bundle_url(rman::BundleID bundle_id) const {
+        return remote_ + fmt::format(u8"/bundles/{:016X}.bundle", bundle_id);
+    }
+
+    // Size of bundle file described by manifest: chunk data followed by footer
+    static std::uint64_t bundle_size(rman::RMANBundle const& bundle) noexcept {
+        auto result = std::uint64_t{sizeof(rman::RBUNFooter) + bundle.chunks.size() * sizeof(rman::RBUNChunk)};
+        for (auto const& chunk: bundle.chunks) {
+            result += chunk.compressed_size;
+        }
+        return result;
+    }
+
+    bool has_complete_bundle(rman::RMANBundle const& bundle) const {
         if (!is_chunking_) {
-            auto out = MMap<char>{};
-            bt_rethrow(out.create(local_bundle_path, remote_bundle_buffer.size()).unwrap());
-            std::memcpy(out.data(), remote_bundle_buffer.data(), remote_bundle_buffer.size());
-        } else {
-            for (size_t offset = 0; auto const& chunk: rbun.chunks) {
-                auto local_chunk_path = cdn_ / fmt::format(u8"{:016X}.chunk", chunk.id);
-                if (!fs::exists(local_chunk_path)) {
-                    bt_assert(chunk.compressed_size + offset <= remote_bundle_buffer.size());
-                    remote_chunk_id = {};
-                    remote_chunk_buffer.clear();
-                    remote_chunk_buffer.resize(chunk.uncompressed_size);
-                    auto result = ZSTD_decompress(remote_chunk_buffer.data(), remote_chunk_buffer.size(),
-                                                  remote_bundle_buffer.data() + offset, chunk.compressed_size);
-                    bt_trace("zstd error: {}", ZSTD_getErrorName(result));
-                    bt_assert(!ZSTD_isError(result));
-                    bt_assert(result == chunk.uncompressed_size);
-                    remote_chunk_id = chunk.id;
-                    auto out = MMap<char>{};
-                    bt_rethrow(out.create(local_chunk_path, chunk.uncompressed_size).unwrap());
-                    std::memcpy(out.data(), remote_chunk_buffer.data(), remote_chunk_buffer.size());
+            auto error = std::error_code{};
+            auto const size = fs::file_size(bundle_path(bundle.id), error);
+            return !error && size == bundle_size(bundle);
+        }
+        return std::all_of(bundle.chunks.begin(), bundle.chunks.end(), [&](rman::RMANChunk const& chunk) {
+            return store_->contains(chunk.id) || fs::exists(cdn_ / fmt::format(u8"{:016X}.chunk", chunk.id));
+        });
+    }
+
+    // Marks bundle as used so quota evicts it last, safe to call from several threads.
+    void touch_bundle(rman::BundleID bundle_id) {
+        if (usage_) {
+            usage_->touch(bundle_id);
+        }
+    }
+
+    // With garbage drops everything retained manifests do not reference, then evicts least recently
+    // used data that is neither retained nor used by this process until cache fits under quota.
+    ManagerRMAN::CollectResult collect(bool garbage, std::uint64_t quota, std::size_t threads) {
+        struct Item {
+            std::uint64_t id;
+            std::uint64_t size;
+            std::uint32_t accessed;
+            bool pinned;
+            fs::path path;
+        };
+        auto const pins = rman::CachePins::load(cdn_);
+        if (usage_) {
+            usage_->refresh();
+        }
+        auto items = std::vector<Item>{};
+        auto total = std::uint64_t{};
+        if (fs::exists(cdn_)) {
+            // Loose chunk files from older caches carry no access time, eviction takes them first
+            auto const extension = is_chunking_ ? std::string_view(".chunk") : std::string_view(".bundle");
+            for (auto const& file: fs::directory_iterator(cdn_)) {
+                auto const name = file.path().filename().generic_string();
+                auto value = std::uint64_t{};
+                if (name.size() != 16 + extension.size() || !name.ends_with(extension)) {
+                    continue;
+                }
+                auto const result = std::from_chars(name.data(), name.data() + 16, value, 16);
+                if (result.ec != std::errc{} || result.ptr != name.data() + 16) {
+                    continue;
+                }
+                auto const pinned = is_chunking_ ? pins.chunks.contains(static_cast<rman::ChunkID>(value))
+                                                 : pins.bundles.contains(static_cast<rman::BundleID>(value));
+                auto const accessed = is_chunking_ ? 0 : usage_->accessed(static_cast<rman::BundleID>(value));
+                items.push_back({ value, file.file_size(), accessed, pinned, file.path() });
+                total += items.back().size;
+            }
+        }
+        auto const file_count = items.size();
+        if (is_chunking_) {
+            for (auto const& entry: store_->entries()) {
+                items.push_back({ static_cast<std::uint64_t>(entry.id), entry.size, entry.accessed,
+                                  pins.chunks.contains(entry.id), {} });
+            }
+            total += store_->size_on_disk();
+        }
+
+        auto drop = std::vector<bool>(items.size());
+        auto dropped = std::uint64_t{};
+        for (std::size_t index = 0; index != items.size(); ++index) {
+            if (garbage && !items[index].pinned) {
+                drop[index] = true;
+                dropped += items[index].size;
+            }
+        }
+        // Evict below quota so next runs do not sweep again right away
+        auto const target = quota - quota / 10;
+        if (quota && total - dropped > quota) {
+            auto order = std::vector<std::size_t>{};
+            for (std::size_t index = 0; index != items.size(); ++index) {
+                if (!drop[index] && !items[index].pinned && items[index].accessed < session_start_) {
+                    order.push_back(index);
                 }
-                offset += chunk.compressed_size;
+            }
+            std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+                return items[lhs].accessed < items[rhs].accessed;
+            });
+            for (auto const index: order) {
+                if (total - dropped <= target) {
+                    break;
+                }
+                drop[index] = true;
+                dropped += items[index].size;
             }
         }
 
-        return remote_bundle_buffer;
+        auto result = ManagerRMAN::CollectResult{};
+        auto victims = std::vector<std::size_t>{};
+        for (std::size_t index = 0; index != items.size(); ++index) {
+            if (drop[index]) {
+                result.removed++;
+                if (index < file_count) {
+                    victims.push_back(index);
+                }
+            } else {
+                result.kept++;
+                result.bytes_kept += items[index].size;
+            }
+        }
+
+        // Files are removed in one parallel sweep, packed chunks in one compaction
+        local_bundle_files.clear();
+        auto next = std::atomic<std::size_t>{};
+        auto bytes_removed = std::atomic<std::uint64_t>{};
+        auto const worker = [&] {
+            for (std::size_t index; (index = next++) < victims.size();) {
+                auto const& item = items[victims[index]];
+                auto error = std::error_code{};
+                if (fs::remove(item.path, error)) {
+                    bytes_removed += item.size;
+                }
+                if (!is_chunking_) {
+                    usage_->forget(static_cast<rman::BundleID>(item.id));
+                }
+            }
+        };
+        auto pool = std::vector<std::thread>{};
+        for (std::size_t i = 0; i != std::min(threads, victims.size()); ++i) {
+            pool.emplace_back(worker);
+        }
+        for (auto& thread: pool) {
+            thread.join();
+        }
+        result.bytes_removed = bytes_removed;
+        if (is_chunking_ && std::any_of(drop.begin() + file_count, drop.end(), [](bool value) { return value; })) {
+            auto evicted = std::unordered_set<rman::ChunkID>{};
+            for (std::size_t index = file_count; index != items.size(); ++index) {
+                if (drop[index]) {
+                    evicted.insert(static_cast<rman::ChunkID>(items[index].id));
+                }
+            }
+            result.bytes_removed += store_->compact([&](rman::ChunkID id) { return !evicted.contains(id); });
+        }
+        if (usage_) {
+            usage_->save();
+        }
+        return result;
+    }
+
+    // Safe to call from several threads, chunk store does its own locking.
+    void store_bundle_chunks(rman::RBUNBundle const& rbun, std::span<char const> data,
+                             ZSTD_DCtx* dctx, std::vector<char>& buffer) {
+        for (std::size_t offset = 0; auto const& chunk: rbun.chunks) {
+            bt_assert(chunk.compressed_size + offset <= data.size());
+            auto const src = data.subspan(offset, chunk.compressed_size);
+            offset += chunk.compressed_size;
+            if (store_->contains(chunk.id)) {
+                continue;
+            }
+            if (compressed_) {
+                store_->put(chunk.id, src, true);
+                continue;
+            }
+            buffer.resize(chunk.uncompressed_size);
+            auto result = ZSTD_decompressDCtx(dctx, buffer.data(), buffer.size(), src.data(), src.size());
+            bt_trace("zstd error: {}", ZSTD_getErrorName(result));
+            bt_assert(!ZSTD_isError(result));
+            bt_assert(result == chunk.uncompressed_size);
+            store_->put(chunk.id, buffer);
+        }
+        store_->flush();
     }
 
 
 private:
     fs::path cdn_;
     std::u8string remote_;
+    bool ranged_ = false;
+    bool compressed_ = false;
     bool is_chunking_ = false;
-    void* curl_ = nullptr;
-
-    rman::BundleID remote_bundle_id = {};
-    std::vector<char> remote_bundle_buffer = {};
+    std::uint64_t quota_ = {};
+    // Data accessed since is in use by this process and never evicted
+    std::uint32_t session_start_ = rman::access_time_now();
+    std::unique_ptr<rman::ChunkStore> store_;
+    std::unique_ptr<rman::CacheUsage> usage_;
+    std::unique_ptr<rman::BundleIndex> index_;
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx_ = { ZSTD_createDCtx(), &ZSTD_freeDCtx };
+    std::unique_ptr<rman::Download> download_;
 
     rman::ChunkID remote_chunk_id = {};
     std::vector<char> remote_chunk_buffer = {};
 
-    rman::BundleID local_bundle_id = {};
-    MMap<char const> local_bundle_file = {};
+    // Most recently used first
+    static constexpr std::size_t MAX_OPEN_BUNDLES = 16;
+    std::vector<std::pair<rman::BundleID, PRead>> local_bundle_files = {};
+    std::vector<char> read_buffer = {};
 
     rman::ChunkID local_chunk_id = {};
     MMap<char const> local_chunk_file = {};
-
-    static size_t write_remote_bundle(char const* p, size_t s, size_t n, CacheRMAN *o) noexcept {
-        s *= n;
-        o->remote_bundle_buffer.insert(o->remote_bundle_buffer.end(), p, p + s);
-        return s;
-    }
 };
 
 struct FileRMAN::Reader final : IReader {
@@ -222,10 +600,14 @@ private:
             return std::tie(lhs.bundle_id, lhs.id, lhs.uncompressed_offset)
                     < std::tie(rhs.bundle_id, rhs.id, rhs.uncompressed_offset);
         };
-        auto const start = std::lower_bound(info_.chunks.begin(), info_.chunks.end(), offset, compare_offset);
+        // First chunk is the last one that starts at or before offset
+        auto start = std::upper_bound(info_.chunks.begin(), info_.chunks.end(), offset, compare_offset);
+        if (start != info_.chunks.begin()) {
+            --start;
+        }
         auto const end = std::lower_bound(start, info_.chunks.end(), offset + size, compare_offset);
         auto ranges = std::vector<rman::FileChunk> { start, end };
-        std::remove_if(ranges.begin(), ranges.end(), [this] (rman::FileChunk const& chunk) {
+        std::erase_if(ranges, [this] (rman::FileChunk const& chunk) {
             return maped_.contains(chunk.uncompressed_offset);
         });
         std::sort(ranges.begin(), ranges.end(), compare_id);
@@ -277,6 +659,20 @@ std::u8string FileRMAN::id() const {
     return fmt::format(u8"{:016x}.fid", info_.id);
 }
 
+std::u8string FileRMAN::content_id() const {
+    if (!info_.link.empty()) {
+        return {};
+    }
+    // Chunk ids hash chunk data, so same id sequence means same bytes
+    auto low = XXH64_stream{};
+    auto high = XXH64_stream{0x9E3779B97F4A7C15};
+    for (auto const& chunk: info_.chunks) {
+        low.update(&chunk.id, sizeof(chunk.id));
+        high.update(&chunk.id, sizeof(chunk.id));
+    }
+    return fmt::format(u8"{:016x}{:016x}.{}.cid", low.digest(), high.digest(), info_.size);
+}
+
 std::shared_ptr<Location> FileRMAN::location() const {
     return location_;
 }
@@ -291,6 +687,25 @@ std::shared_ptr<IReader> FileRMAN::open() {
     }
 }
 
+void FileRMAN::stream(std::function<void(std::span<char const>)> const& sink) {
+    // Reader that already mapped chunks is cheaper to reuse than fetching chunks again
+    if (!reader_.expired()) {
+        return IFile::stream(sink);
+    }
+    bt_trace(u8"path: {}", info_.path);
+    bt_assert(info_.link.empty());
+    auto offset = std::uint32_t{};
+    for (auto const& chunk: info_.chunks) {
+        bt_trace(u8"chunk: {:016X}", chunk.id);
+        bt_assert(chunk.uncompressed_offset == offset);
+        auto const src = cache_->open_chunk(chunk);
+        bt_assert(src.size() == chunk.uncompressed_size);
+        sink(src);
+        offset += chunk.uncompressed_size;
+    }
+    bt_assert(offset == info_.size);
+}
+
 bool FileRMAN::is_wad() {
     if (!info_.link.empty()) {
         return false;
@@ -302,17 +717,39 @@ bool FileRMAN::is_wad() {
 ManagerRMAN::ManagerRMAN(std::shared_ptr<IReader> source,
                          fs::path cdn,
                          std::u8string remote,
+                         bool ranged,
+                         bool compressed,
+                         std::uint64_t quota,
                          std::set<std::u8string> const& langs,
                          std::shared_ptr<Location> source_location)
-    : cache_(std::make_shared<CacheRMAN>(cdn, remote))
+    : source_(source)
+    , cache_(std::make_shared<CacheRMAN>(cdn, remote, ranged, compressed, quota))
     , location_(std::make_shared<Location>(source_location))
+    , langs_(langs)
 {
-    auto manifest = rman::RMANManifest::read(source->read());
-    location_->path = fmt::format(u8"{:016x}.manifest", manifest.id);
-    files_ = manifest.list_files();
-    if (!langs.empty()) {
-        std::erase_if(files_, [&langs] (rman::FileInfo const& info) -> bool {
-            for (auto const& lang: langs) {
+    auto const data = source->read();
+    auto const manifest_id = rman::RMANManifest::read_id(data);
+    location_->path = fmt::format(u8"{:016x}.manifest", manifest_id);
+    auto const cache_path = cdn / u8"manifests" / fmt::format(u8"{:016X}.filecache", manifest_id);
+    if (auto cached = rman::FileCache::read(cache_path, manifest_id)) {
+        files_ = std::move(*cached);
+    } else {
+        auto manifest = rman::RMANManifest::read(data);
+        files_ = manifest.list_files();
+        // Cache is best effort, mirror might be read only
+        try {
+            rman::FileCache::write(cache_path, manifest_id, files_);
+        } catch (std::exception const&) {
+            bt::error_stack().clear();
+        }
+    }
+    filter_langs(files_);
+}
+
+void ManagerRMAN::filter_langs(std::vector<rman::FileInfo>& files) const {
+    if (!langs_.empty()) {
+        std::erase_if(files, [this] (rman::FileInfo const& info) -> bool {
+            for (auto const& lang: langs_) {
                 if (info.langs.contains(lang)) {
                     return false;
                 }
@@ -322,6 +759,226 @@ ManagerRMAN::ManagerRMAN(std::shared_ptr<IReader> source,
     }
 }
 
+rman::ManifestDiff ManagerRMAN::diff(fs::path const& old_manifest) const {
+    bt_trace(u8"old manifest: {}", old_manifest.generic_u8string());
+    auto file = MMap<char const>{};
+    bt_rethrow(file.open(old_manifest).unwrap());
+    auto old_files = rman::RMANManifest::read(file.span()).list_files();
+    filter_langs(old_files);
+    return rman::ManifestDiff::compute(std::move(old_files), files_);
+}
+
+void ManagerRMAN::keep_changed(rman::ManifestDiff const& diff) {
+    auto changed = std::vector<rman::FileInfo>{};
+    for (auto const& entry: diff.entries) {
+        if (entry.new_index != rman::ManifestDiff::npos) {
+            changed.push_back(diff.new_files[entry.new_index]);
+        }
+    }
+    files_ = std::move(changed);
+}
+
+ManagerRMAN::PatchResult ManagerRMAN::patch(rman::ManifestDiff const& diff, fs::path const& root) {
+    using Change = rman::ManifestDiff::Change;
+
+    auto result = PatchResult{};
+
+    // Fetches every chunk of file not already present in old copy and writes it to all its places
+    auto const write_fetched = [&](PFile& out, std::vector<rman::FileChunk const*>& fetches) {
+        std::sort(fetches.begin(), fetches.end(), [](auto const* lhs, auto const* rhs) {
+            return std::tie(lhs->bundle_id, lhs->compressed_offset, lhs->uncompressed_offset)
+                 < std::tie(rhs->bundle_id, rhs->compressed_offset, rhs->uncompressed_offset);
+        });
+        for (auto const* chunk: fetches) {
+            bt_trace(u8"chunk: {:016X}", chunk->id);
+            auto const src = cache_->open_chunk(*chunk);
+            bt_assert(src.size() == chunk->uncompressed_size);
+            bt_rethrow(out.write(chunk->uncompressed_offset, src).unwrap());
+            result.bytes_written += src.size();
+        }
+    };
+
+    // Marker lists target manifest and every file this run started to rewrite, it is removed once patch is done.
+    // Marker left by unfinished run means those files may be half written and their old copy can not be trusted.
+    auto const marker_path = root / u8".patching";
+    auto untrusted = std::unordered_set<std::u8string>{};
+    bt_rethrow(fs::create_directories(root));
+    auto marker = PFile{};
+    bt_rethrow(marker.open(marker_path).unwrap());
+    if (marker.size() != 0) {
+        auto data = std::string(marker.size(), '\0');
+        bt_rethrow(marker.read(0, data).unwrap());
+        auto lines = std::u8string_view(reinterpret_cast<char8_t const*>(data.data()), data.size());
+        // First line is manifest unfinished run was patching to
+        lines.remove_prefix(std::min(lines.find(u8'\n'), lines.size() - 1) + 1);
+        while (!lines.empty()) {
+            auto const line = lines.substr(0, lines.find(u8'\n'));
+            untrusted.emplace(line);
+            lines.remove_prefix(std::min(line.size() + 1, lines.size()));
+        }
+        bt_trace(u8"untrusted: {}", untrusted.size());
+    }
+    auto const mark = [&](std::u8string_view line) {
+        auto data = std::string(line.begin(), line.end()) + '\n';
+        bt_rethrow(marker.write(marker.size(), data).unwrap());
+    };
+    if (marker.size() == 0) {
+        mark(location_->path.generic_u8string());
+    }
+
+    // Limit on bytes of old copy that are held in memory to be moved to their new offsets in place
+    constexpr auto MOVE_LIMIT = std::uint64_t{256} * 1024 * 1024;
+
+    // Chunks already at their offset are left alone, moved ones are read before anything is written over them.
+    // Untrusted, hardlinked and copies too big to move in memory are built next to old copy and renamed over it.
+    auto const patch_file = [&](rman::FileInfo const& file, rman::FileInfo const* old) {
+        bt_trace(u8"path: {}", file.path);
+        auto const path = root / file.path;
+        bt_rethrow(fs::create_directories(path.parent_path()));
+        auto out = PFile{};
+        bt_rethrow(out.open(path).unwrap());
+        // Copy that does not match what older manifest describes can not be trusted for anything
+        auto trusted = true;
+        if (old && (out.size() != old->size || untrusted.contains(file.path))) {
+            ++result.untrusted;
+            trusted = false;
+            old = nullptr;
+        }
+        auto old_offsets = std::unordered_map<rman::ChunkID, std::uint32_t>{};
+        if (old) {
+            for (auto const& chunk: old->chunks) {
+                old_offsets.try_emplace(chunk.id, chunk.uncompressed_offset);
+            }
+        }
+        auto fetches = std::vector<rman::FileChunk const*>{};
+        auto moves = std::vector<std::pair<rman::FileChunk const*, std::uint32_t>>{};
+        auto kept_size = std::uint64_t{};
+        auto moved_size = std::uint64_t{};
+        for (auto const& chunk: file.chunks) {
+            auto const i = old_offsets.find(chunk.id);
+            if (i == old_offsets.end()) {
+                fetches.push_back(&chunk);
+            } else if (i->second == chunk.uncompressed_offset) {
+                kept_size += chunk.uncompressed_size;
+            } else {
+                moves.emplace_back(&chunk, i->second);
+                moved_size += chunk.uncompressed_size;
+            }
+        }
+        if (fetches.empty() && moves.empty() && out.size() == file.size) {
+            // Copy already holds every chunk where it belongs
+            result.bytes_kept += kept_size;
+            return;
+        }
+        mark(file.path);
+
+        auto buffer = std::vector<char>{};
+        if (trusted && moved_size <= MOVE_LIMIT && fs::hard_link_count(path) == 1) {
+            buffer.resize(moved_size);
+            auto dst = std::span<char>(buffer);
+            for (auto const& [chunk, src_offset]: moves) {
+                bt_rethrow(out.read(src_offset, dst.subspan(0, chunk->uncompressed_size)).unwrap());
+                dst = dst.subspan(chunk->uncompressed_size);
+            }
+            bt_rethrow(out.resize(file.size).unwrap());
+            auto src = std::span<char const>(buffer);
+            for (auto const& [chunk, src_offset]: moves) {
+                bt_rethrow(out.write(chunk->uncompressed_offset, src.subspan(0, chunk->uncompressed_size)).unwrap());
+                src = src.subspan(chunk->uncompressed_size);
+            }
+            result.bytes_kept += kept_size;
+            result.bytes_moved += moved_size;
+            write_fetched(out, fetches);
+            return;
+        }
+
+        // Every reused chunk is copied into new file, so none of it counts as kept
+        auto const tmp_path = fs::path(path) += u8".patch";
+        bt_rethrow(fs::remove(tmp_path));
+        auto tmp = PFile{};
+        bt_rethrow(tmp.open(tmp_path).unwrap());
+        bt_rethrow(tmp.resize(file.size).unwrap());
+        if (old) {
+            for (auto const& chunk: file.chunks) {
+                auto const i = old_offsets.find(chunk.id);
+                if (i == old_offsets.end()) {
+                    continue;
+                }
+                buffer.resize(chunk.uncompressed_size);
+                bt_rethrow(out.read(i->second, buffer).unwrap());
+                bt_rethrow(tmp.write(chunk.uncompressed_offset, buffer).unwrap());
+                result.bytes_moved += buffer.size();
+            }
+        }
+        write_fetched(tmp, fetches);
+        tmp.close();
+        out.close();
+        bt_rethrow(fs::rename(tmp_path, path));
+    };
+
+    for (auto const& entry: diff.entries) {
+        if (entry.change != Change::Removed) {
+            continue;
+        }
+        auto const& old = diff.old_files[entry.old_index];
+        bt_trace(u8"path: {}", old.path);
+        bt_rethrow(fs::remove(root / old.path));
+        ++result.removed;
+    }
+
+    // Renames can form chains or swaps, so move every source aside before placing any
+    auto renamed = std::vector<std::pair<fs::path, rman::FileInfo const*>>{};
+    for (auto const& entry: diff.entries) {
+        if (entry.change != Change::Renamed) {
+            continue;
+        }
+        auto const& old = diff.old_files[entry.old_index];
+        auto const& file = diff.new_files[entry.new_index];
+        if (!file.link.empty()) {
+            continue;
+        }
+        auto src_path = root / old.path;
+        auto tmp_path = fs::path(src_path) += u8".rename";
+        if (fs::exists(src_path)) {
+            bt_trace(u8"path: {}", old.path);
+            bt_rethrow(fs::rename(src_path, tmp_path));
+            renamed.emplace_back(std::move(tmp_path), &file);
+        } else {
+            // Nothing to rename, treat as new file instead
+            patch_file(file, nullptr);
+        }
+        ++result.renamed;
+    }
+    for (auto const& [tmp_path, file]: renamed) {
+        bt_trace(u8"path: {}", file->path);
+        auto const path = root / file->path;
+        bt_rethrow(fs::create_directories(path.parent_path()));
+        bt_rethrow(fs::rename(tmp_path, path));
+        // Content is same so this only rewrites copy whose size went wrong
+        patch_file(*file, file);
+    }
+
+    for (auto const& entry: diff.entries) {
+        if (entry.change != Change::Added && entry.change != Change::Modified) {
+            continue;
+        }
+        auto const& file = diff.new_files[entry.new_index];
+        if (!file.link.empty()) {
+            continue;
+        }
+        if (entry.change == Change::Added) {
+            patch_file(file, nullptr);
+            ++result.added;
+        } else {
+            patch_file(file, &diff.old_files[entry.old_index]);
+            ++result.modified;
+        }
+    }
+    marker.close();
+    bt_rethrow(fs::remove(marker_path));
+    return result;
+}
+
 std::vector<std::shared_ptr<IFile>> ManagerRMAN::list() {
     auto result = std::vector<std::shared_ptr<IFile>>{};
     result.reserve(files_.size());
@@ -330,3 +987,440 @@ std::vector<std::shared_ptr<IFile>> ManagerRMAN::list() {
     }
     return result;
 }
+
+void ManagerRMAN::extract(std::span<ExtractJob const> jobs, std::size_t threads) {
+    struct Output {
+        std::size_t index;
+        fs::path path;
+        MMap<char> file;
+        std::atomic<std::size_t> remaining;
+    };
+    struct Task {
+        Output* output;
+        // Every place in file that holds this chunk
+        std::vector<rman::FileChunk> targets;
+        std::vector<char> src;
+        bool compressed;
+    };
+    constexpr std::size_t TASK_LIMIT = 256;
+    constexpr std::size_t IN_FLIGHT_LIMIT = 512 * 1024 * 1024;
+
+    auto outputs = std::vector<std::unique_ptr<Output>>(jobs.size());
+    auto tasks = BoundedQueue<Task>(TASK_LIMIT);
+    auto finished = BoundedQueue<std::size_t>(jobs.size() + 1);
+    auto in_flight_mutex = std::mutex{};
+    auto in_flight_changed = std::condition_variable{};
+    auto in_flight = std::size_t{};
+    auto failed = std::atomic<bool>{};
+    auto error_mutex = std::mutex{};
+    auto error = std::exception_ptr{};
+    auto error_stack = bt::error_stack_t{};
+
+    // First error wins, its trace is carried over to calling thread
+    auto const fail = [&] {
+        {
+            auto const lock = std::lock_guard(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+                error_stack = std::move(bt::error_stack());
+            }
+            bt::error_stack().clear();
+        }
+        failed = true;
+        tasks.close();
+        finished.close();
+        auto const lock = std::lock_guard(in_flight_mutex);
+        in_flight_changed.notify_all();
+    };
+
+    auto const decompress = [&] {
+        try {
+            auto const dctx = std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+            while (auto task = tasks.pop()) {
+                if (failed) {
+                    continue;
+                }
+                auto& output = *task->output;
+                auto const& first = task->targets.front();
+                bt_trace(u8"path: {}", output.path.generic_u8string());
+                bt_trace(u8"chunk: {:016X}", first.id);
+                bt_assert(first.uncompressed_offset + first.uncompressed_size <= output.file.size());
+                auto const dst = output.file.data() + first.uncompressed_offset;
+                if (task->compressed) {
+                    auto result = ZSTD_decompressDCtx(dctx.get(), dst, first.uncompressed_size,
+                                                      task->src.data(), task->src.size());
+                    bt_trace("zstd error: {}", ZSTD_getErrorName(result));
+                    bt_assert(!ZSTD_isError(result));
+                    bt_assert(result == first.uncompressed_size);
+                } else {
+                    bt_assert(task->src.size() == first.uncompressed_size);
+                    std::memcpy(dst, task->src.data(), task->src.size());
+                }
+                for (auto const& target: std::span(task->targets).subspan(1)) {
+                    bt_assert(target.uncompressed_offset + target.uncompressed_size <= output.file.size());
+                    std::memcpy(output.file.data() + target.uncompressed_offset, dst, first.uncompressed_size);
+                }
+                if (--output.remaining == 0) {
+                    finished.push(output.index);
+                }
+            }
+        } catch (std::exception const&) {
+            fail();
+        }
+    };
+
+    auto const write = [&] {
+        try {
+            while (auto index = finished.pop()) {
+                auto& output = outputs[*index];
+                bt_trace(u8"path: {}", output->path.generic_u8string());
+                auto const size = output->file.size();
+                bt_rethrow(output->file.close().unwrap());
+                output.reset();
+                auto const lock = std::lock_guard(in_flight_mutex);
+                in_flight -= size;
+                in_flight_changed.notify_all();
+            }
+        } catch (std::exception const&) {
+            fail();
+        }
+    };
+
+    auto workers = std::vector<std::thread>{};
+    for (std::size_t i = 0; i != std::max(threads, std::size_t{1}); ++i) {
+        workers.emplace_back(decompress);
+    }
+    auto writer = std::thread(write);
+
+    try {
+        for (std::size_t index = 0; index != jobs.size() && !failed; ++index) {
+            auto const& job = jobs[index];
+            auto const file = std::dynamic_pointer_cast<FileRMAN>(job.file);
+            bt_assert(file);
+            auto const& info = file->info();
+            bt_trace(u8"path: {}", info.path);
+            {
+                // Look ahead is bounded by bytes of files not written out yet
+                auto lock = std::unique_lock(in_flight_mutex);
+                in_flight_changed.wait(lock, [&] {
+                    return failed || in_flight == 0 || in_flight + info.size <= IN_FLIGHT_LIMIT;
+                });
+                in_flight += info.size;
+            }
+            auto output = std::make_unique<Output>();
+            output->index = index;
+            output->path = job.path;
+            bt_rethrow(fs::create_directories(job.path.parent_path()));
+            // Output of earlier run may be hardlinked to other files, writing into it would change them too
+            bt_rethrow(fs::remove(job.path));
+            bt_rethrow(output->file.create(job.path, info.size).unwrap());
+
+            // Each chunk is fetched and decompressed once per file, in bundle order
+            auto chunks = info.chunks;
+            std::sort(chunks.begin(), chunks.end(), [](auto const& lhs, auto const& rhs) {
+                return std::tie(lhs.bundle_id, lhs.id, lhs.uncompressed_offset)
+                    < std::tie(rhs.bundle_id, rhs.id, rhs.uncompressed_offset);
+            });
+            auto groups = std::vector<std::span<rman::FileChunk const>>{};
+            for (auto i = std::span<rman::FileChunk const>(chunks); !i.empty();) {
+                auto count = std::size_t{1};
+                while (count != i.size() && i[count].id == i.front().id) {
+                    ++count;
+                }
+                groups.push_back(i.subspan(0, count));
+                i = i.subspan(count);
+            }
+            // Extra count keeps file from finishing before all of its tasks are queued
+            output->remaining = groups.size() + 1;
+            auto& current = *(outputs[index] = std::move(output));
+            for (auto const& group: groups) {
+                auto task = Task { &current, { group.begin(), group.end() }, {}, false };
+                task.compressed = cache_->load_chunk(group.front(), task.src);
+                if (!tasks.push(std::move(task))) {
+                    break;
+                }
+            }
+            if (--current.remaining == 0) {
+                finished.push(index);
+            }
+        }
+    } catch (std::exception const&) {
+        fail();
+    }
+    tasks.close();
+    for (auto& worker: workers) {
+        worker.join();
+    }
+    finished.close();
+    writer.join();
+    if (error) {
+        auto& stack = bt::error_stack();
+        stack.insert(stack.end(), error_stack.begin(), error_stack.end());
+        std::rethrow_exception(error);
+    }
+}
+
+ManagerRMAN::MirrorResult ManagerRMAN::mirror(std::span<fs::path const> manifests,
+                                               fs::path cdn,
+                                               std::u8string remote,
+                                               bool compressed,
+                                               std::uint64_t quota,
+                                               std::size_t threads) {
+    bt_assert(!remote.empty() && "Mirror needs remote to fetch from!");
+    auto bundles = std::map<rman::BundleID, rman::RMANBundle>{};
+    for (auto const& path: manifests) {
+        bt_trace(u8"manifest: {}", path.generic_u8string());
+        auto file = MMap<char const>{};
+        bt_rethrow(file.open(path).unwrap());
+        auto manifest = rman::RMANManifest::read(file.span());
+        for (auto& bundle: manifest.bundles) {
+            bundles.try_emplace(bundle.id, std::move(bundle));
+        }
+    }
+
+    auto cache = CacheRMAN(std::move(cdn), std::move(remote), false, compressed, quota);
+    auto result = MirrorResult{};
+    auto todo = std::vector<rman::RMANBundle const*>{};
+    for (auto const& [bundle_id, bundle]: bundles) {
+        auto const size = CacheRMAN::bundle_size(bundle);
+        result.bundles_planned++;
+        result.bytes_planned += size;
+        if (cache.has_complete_bundle(bundle)) {
+            cache.touch_bundle(bundle.id);
+            result.bundles_skipped++;
+            result.bytes_skipped += size;
+        } else {
+            todo.push_back(&bundle);
+        }
+    }
+
+    // Curl handles are created up front, lazy global init in curl is not thread safe
+    auto downloads = std::vector<rman::Download>(std::min(std::max(threads, std::size_t{1}), todo.size()));
+    auto errors = std::vector<std::optional<std::u8string>>(todo.size());
+    auto next = std::atomic<std::size_t>{};
+    auto fetched = std::atomic<std::size_t>{};
+    auto bytes_fetched = std::atomic<std::uint64_t>{};
+    auto skipped = std::atomic<std::size_t>{};
+    auto bytes_skipped = std::atomic<std::uint64_t>{};
+    auto const worker = [&](rman::Download& download) {
+        auto const dctx = std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+        auto buffer = std::vector<char>{};
+        for (std::size_t index; (index = next++) < todo.size();) {
+            auto const& bundle = *todo[index];
+            auto const path = cache.bundle_path(bundle.id);
+            auto const part_path = fs::path(path) += u8".part";
+            auto downloaded = false;
+            auto lock = FileLock{};
+            try {
+                lock = cache.lock_bundle(bundle.id);
+                // Another mirror sharing this cache finished it while we waited
+                if (cache.has_complete_bundle(bundle)) {
+                    lock.unlock(true);
+                    skipped++;
+                    bytes_skipped += CacheRMAN::bundle_size(bundle);
+                    continue;
+                }
+                bytes_fetched += download.fetch(cache.bundle_url(bundle.id), part_path);
+                downloaded = true;
+                auto file = MMap<char const>{};
+                bt_rethrow(file.open(part_path).unwrap());
+                // Footer has to describe exactly the chunks manifest expects
+                auto const rbun = bt_rethrow(rman::RBUNBundle::read(file.span()));
+                auto const matches = rbun.id == bundle.id
+                    && file.size() == CacheRMAN::bundle_size(bundle)
+                    && std::equal(rbun.chunks.begin(), rbun.chunks.end(), bundle.chunks.begin(), bundle.chunks.end(),
+                                  [](rman::RBUNChunk const& lhs, rman::RMANChunk const& rhs) {
+                                      return lhs.id == rhs.id && lhs.compressed_size == rhs.compressed_size;
+                                  });
+                bt_assert(matches && "Bundle footer does not match manifest");
+                if (cache.is_chunking()) {
+                    cache.store_bundle_chunks(rbun, file.span(), dctx.get(), buffer);
+                    bt_rethrow(file.close().unwrap());
+                    bt_rethrow(fs::remove(part_path));
+                } else {
+                    bt_rethrow(file.close().unwrap());
+                    bt_rethrow(fs::rename(part_path, path));
+                }
+                cache.touch_bundle(bundle.id);
+                lock.unlock(true);
+                fetched++;
+            } catch (std::exception const& error) {
+                // Interrupted transfer is resumed next time, but bad data would only be resumed again
+                auto ec = std::error_code{};
+                if (lock && (downloaded || fs::file_size(part_path, ec) == 0)) {
+                    fs::remove(part_path, ec);
+                }
+                lock.unlock(true);
+                auto const what = std::string_view(error.what());
+                auto message = std::u8string(what.begin(), what.end());
+                for (auto const& trace: bt::error_stack()) {
+                    message += u8"; " + trace;
+                }
+                errors[index] = std::move(message);
+                bt::error_stack().clear();
+            }
+        }
+    };
+    auto workers = std::vector<std::thread>{};
+    for (auto& download: downloads) {
+        workers.emplace_back(worker, std::ref(download));
+    }
+    for (auto& thread: workers) {
+        thread.join();
+    }
+
+    result.bundles_fetched = fetched;
+    result.bytes_fetched = bytes_fetched;
+    result.bundles_skipped += skipped;
+    result.bytes_skipped += bytes_skipped;
+    for (std::size_t index = 0; index != todo.size(); ++index) {
+        if (errors[index]) {
+            result.errors.push_back({ todo[index]->id, rman::ChunkID::None, std::move(*errors[index]) });
+        }
+    }
+    return result;
+}
+
+ManagerRMAN::CollectResult ManagerRMAN::collect(std::span<fs::path const> manifests,
+                                                 fs::path cdn,
+                                                 std::uint64_t quota,
+                                                 std::size_t threads) {
+    auto retained = std::vector<rman::RMANManifest>{};
+    for (auto const& path: manifests) {
+        bt_trace(u8"manifest: {}", path.generic_u8string());
+        auto file = MMap<char const>{};
+        bt_rethrow(file.open(path).unwrap());
+        retained.push_back(rman::RMANManifest::read(file.span()));
+    }
+    auto cache = CacheRMAN(std::move(cdn), {}, false, false, 0);
+    rman::CachePins::retain(cache.path(), retained);
+    return cache.collect(true, quota, threads);
+}
+
+std::vector<ManagerRMAN::VerifyError> ManagerRMAN::verify(std::size_t threads) {
+    auto const manifest = rman::RMANManifest::read(source_->read());
+    // Chunks are hashed with the type from params of files that use them
+    auto hash_types = std::unordered_map<rman::ChunkID, rman::HashType>{};
+    for (auto const& file: manifest.files) {
+        if (file.params_index < manifest.params.size()) {
+            for (auto const chunk_id: file.chunk_ids) {
+                hash_types.emplace(chunk_id, manifest.params[file.params_index].hash_type);
+            }
+        }
+    }
+    auto const default_type = manifest.params.empty() ? rman::HashType::None : manifest.params.front().hash_type;
+    auto const& root = cache_->path();
+    auto const is_chunking = cache_->is_chunking();
+    auto results = std::vector<std::vector<VerifyError>>(manifest.bundles.size());
+    auto next = std::atomic<std::size_t>{};
+    auto const worker = [&] {
+        auto const dctx = std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+        auto buffer = std::vector<char>{};
+        for (std::size_t index; (index = next++) < manifest.bundles.size();) {
+            auto const& bundle = manifest.bundles[index];
+            auto& errors = results[index];
+            auto const report = [&](rman::ChunkID chunk_id, std::string_view error) {
+                errors.push_back({ bundle.id, chunk_id, { error.begin(), error.end() } });
+            };
+            auto const check = [&](rman::RMANChunk const& chunk, std::span<char const> data) {
+                auto const type = hash_types.contains(chunk.id) ? hash_types.at(chunk.id) : default_type;
+                if (type != rman::HashType::None && rman::chunk_hash(data, type) != chunk.id) {
+                    report(chunk.id, "hash mismatch");
+                }
+            };
+            try {
+                if (is_chunking) {
+                    for (auto const& chunk: bundle.chunks) {
+                        auto file = MMap<char const>{};
+                        auto data = std::span<char const>{};
+                        if (auto stored = cache_->store()->get(chunk.id)) {
+                            data = stored->data;
+                            if (stored->compressed) {
+                                buffer.resize(chunk.uncompressed_size);
+                                auto const result = ZSTD_decompressDCtx(dctx.get(), buffer.data(), buffer.size(),
+                                                                        data.data(), data.size());
+                                if (ZSTD_isError(result)) {
+                                    report(chunk.id, ZSTD_getErrorName(result));
+                                    continue;
+                                }
+                                data = std::span<char const>(buffer).subspan(0, result);
+                            }
+                        } else {
+                            auto const path = root / fmt::format(u8"{:016X}.chunk", chunk.id);
+                            if (!fs::exists(path)) {
+                                report(chunk.id, "missing chunk");
+                                continue;
+                            }
+                            bt_rethrow(file.open(path).unwrap());
+                            data = file.span();
+                        }
+                        if (data.size() != chunk.uncompressed_size) {
+                            report(chunk.id, "size mismatch");
+                            continue;
+                        }
+                        check(chunk, data);
+                    }
+                    continue;
+                }
+                auto const path = root / fmt::format(u8"{:016X}.bundle", bundle.id);
+                if (!fs::exists(path)) {
+                    report(rman::ChunkID::None, "missing bundle");
+                    continue;
+                }
+                auto file = MMap<char const>{};
+                bt_rethrow(file.open(path).unwrap());
+                auto const data = file.span();
+                auto const rbun = rman::RBUNBundle::read(data);
+                if (rbun.id != bundle.id) {
+                    report(rman::ChunkID::None, "bundle id mismatch");
+                }
+                if (rbun.chunks.size() != bundle.chunks.size()) {
+                    report(rman::ChunkID::None, "chunk count mismatch");
+                }
+                auto const data_size = data.size() - sizeof(rman::RBUNFooter) - rbun.chunks.size() * sizeof(rman::RBUNChunk);
+                auto offset = std::size_t{};
+                for (std::size_t i = 0; auto const& chunk: bundle.chunks) {
+                    if (i < rbun.chunks.size()) {
+                        auto const& entry = rbun.chunks[i++];
+                        if (entry.id != chunk.id || entry.compressed_size != chunk.compressed_size
+                            || entry.uncompressed_size != chunk.uncompressed_size) {
+                            report(chunk.id, "footer mismatch");
+                        }
+                    }
+                    if (offset + chunk.compressed_size > data_size) {
+                        report(chunk.id, "out of bounds");
+                        break;
+                    }
+                    buffer.resize(chunk.uncompressed_size);
+                    auto const result = ZSTD_decompressDCtx(dctx.get(), buffer.data(), buffer.size(),
+                                                            data.data() + offset, chunk.compressed_size);
+                    offset += chunk.compressed_size;
+                    if (ZSTD_isError(result)) {
+                        report(chunk.id, ZSTD_getErrorName(result));
+                    } else if (result != chunk.uncompressed_size) {
+                        report(chunk.id, "size mismatch");
+                    } else {
+                        check(chunk, buffer);
+                    }
+                }
+            } catch (std::exception const& error) {
+                report(rman::ChunkID::None, error.what());
+                bt::error_stack().clear();
+            }
+        }
+    };
+    threads = std::clamp(threads, std::size_t{1}, std::max(manifest.bundles.size(), std::size_t{1}));
+    auto pool = std::vector<std::thread>{};
+    for (std::size_t i = 1; i != threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread: pool) {
+        thread.join();
+    }
+    auto errors = std::vector<VerifyError>{};
+    for (auto& bundle_errors: results) {
+        errors.insert(errors.end(), bundle_errors.begin(), bundle_errors.end());
+    }
+    return errors;
+}
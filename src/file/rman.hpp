@@ -1,5 +1,6 @@
 #pragma once
 #include <file/base.hpp>
+#include <file/rman/diff.hpp>
 #include <file/rman/manifest.hpp>
 
 namespace file {
@@ -16,9 +17,15 @@ namespace file {
         std::u8string get_link() override;
         std::size_t size() const override;
         std::u8string id() const override;
+        std::u8string content_id() const override;
         std::shared_ptr<Location> location() const override;
         std::shared_ptr<IReader> open() override;
         bool is_wad() override;
+        void stream(std::function<void(std::span<char const>)> const& sink) override;
+
+        rman::FileInfo const& info() const noexcept {
+            return info_;
+        }
 
     private:
         struct Reader;
@@ -32,13 +39,87 @@ namespace file {
         ManagerRMAN(std::shared_ptr<IReader> source,
                     fs::path cdn,
                     std::u8string remote,
+                    bool ranged,
+                    bool compressed,
+                    std::uint64_t quota,
                     std::set<std::u8string> const& langs,
                     std::shared_ptr<Location> source_location);
 
         std::vector<std::shared_ptr<IFile>> list() override;
+
+        // Compares older manifest to this one, with same language filter applied to both.
+        rman::ManifestDiff diff(fs::path const& old_manifest) const;
+
+        // Narrows list() down to files diff found added, modified or renamed.
+        void keep_changed(rman::ManifestDiff const& diff);
+
+        struct PatchResult {
+            std::size_t added = {};
+            std::size_t removed = {};
+            std::size_t renamed = {};
+            std::size_t modified = {};
+            std::size_t untrusted = {};
+            std::uint64_t bytes_kept = {};
+            std::uint64_t bytes_moved = {};
+            std::uint64_t bytes_written = {};
+        };
+
+        // Turns tree extracted from older manifest into this one, chunks of old copy are reused and only the
+        // rest is fetched. Changed files are patched in place, hardlinked ones are built aside and renamed over.
+        // Marker in root keeps files an interrupted run touched, rerun refetches them instead of trusting old copy.
+        PatchResult patch(rman::ManifestDiff const& diff, fs::path const& root);
+
+        // Fetches chunks on calling thread while workers decompress straight into output mappings
+        // and writer thread flushes finished files, stages are joined by bounded queues.
+        void extract(std::span<ExtractJob const> jobs, std::size_t threads) override;
+
+        struct VerifyError {
+            rman::BundleID bundle_id;
+            rman::ChunkID chunk_id;
+            std::u8string error;
+        };
+
+        // Decompresses and rehashes every chunk in local bundles or chunks, bundles are spread across threads.
+        std::vector<VerifyError> verify(std::size_t threads);
+
+        struct MirrorResult {
+            std::size_t bundles_planned = {};
+            std::size_t bundles_skipped = {};
+            std::size_t bundles_fetched = {};
+            std::uint64_t bytes_planned = {};
+            std::uint64_t bytes_skipped = {};
+            std::uint64_t bytes_fetched = {};
+            std::vector<VerifyError> errors;
+        };
+
+        // Fetches union of bundles from manifests that local cache lacks, bundles are spread across threads.
+        static MirrorResult mirror(std::span<fs::path const> manifests,
+                                   fs::path cdn,
+                                   std::u8string remote,
+                                   bool compressed,
+                                   std::uint64_t quota,
+                                   std::size_t threads);
+
+        struct CollectResult {
+            std::size_t removed = {};
+            std::size_t kept = {};
+            std::uint64_t bytes_removed = {};
+            std::uint64_t bytes_kept = {};
+        };
+
+        // Makes manifests the retained set of cache, drops everything they do not reference,
+        // then evicts least recently used data until cache fits quota, zero quota means unbounded.
+        static CollectResult collect(std::span<fs::path const> manifests,
+                                     fs::path cdn,
+                                     std::uint64_t quota,
+                                     std::size_t threads);
     private:
+        std::shared_ptr<IReader> source_;
         std::shared_ptr<CacheRMAN> cache_;
         std::shared_ptr<Location> location_;
         std::vector<rman::FileInfo> files_;
+        std::set<std::u8string> langs_;
+
+        void filter_langs(std::vector<rman::FileInfo>& files) const;
     };
 }
@@ -0,0 +1,167 @@
+#include <common/binfile.hpp>
+#include <common/bt_error.hpp>
+#include <common/mmap.hpp>
+#include <file/rman/bundleindex.hpp>
+#include <charconv>
+
+using namespace rman;
+
+static constexpr auto INDEX_MAGIC = std::array { 'R', 'B', 'I', 'X' };
+static constexpr auto INDEX_VERSION = uint32_t{2};
+
+namespace {
+    struct IndexBundle {
+        BundleID id;
+        std::uint64_t size;
+    };
+
+    struct IndexChunk {
+        ChunkID id;
+        BundleIndex::Location location;
+    };
+}
+
+BundleIndex::BundleIndex(fs::path dir) : dir_(std::move(dir)) {
+    if (!load()) {
+        bundles_.clear();
+        chunks_.clear();
+    }
+}
+
+BundleIndex::~BundleIndex() {
+    // Index is only a shortcut, mirror might be read only
+    try {
+        save();
+    } catch (std::exception const&) {
+        bt::error_stack().clear();
+    }
+}
+
+void BundleIndex::refresh() {
+    auto found = std::unordered_map<BundleID, std::uint64_t>{};
+    for (auto const& file: fs::directory_iterator(dir_)) {
+        auto const name = file.path().filename().generic_string();
+        auto value = std::uint64_t{};
+        if (name.size() != 23 || !name.ends_with(".bundle")) {
+            continue;
+        }
+        auto const result = std::from_chars(name.data(), name.data() + 16, value, 16);
+        if (result.ec == std::errc{} && result.ptr == name.data() + 16) {
+            found[static_cast<BundleID>(value)] = file.file_size();
+        }
+    }
+    auto removed = std::unordered_set<BundleID>{};
+    for (auto const& [bundle_id, size]: bundles_) {
+        if (auto const f = found.find(bundle_id); f == found.end() || f->second != size) {
+            removed.insert(bundle_id);
+        }
+    }
+    forget(removed);
+    for (auto const& [bundle_id, size]: found) {
+        if (bundles_.contains(bundle_id)) {
+            continue;
+        }
+        // Footer sits at the end so mapping only pages in the tail
+        try {
+            auto file = MMap<char const>{};
+            bt_rethrow(file.open(dir_ / fmt::format(u8"{:016X}.bundle", bundle_id)).unwrap());
+            auto const rbun = RBUNBundle::read(file.span());
+            bt_assert(rbun.id == bundle_id);
+            add(bundle_id, size, rbun.chunks);
+        } catch (std::exception const&) {
+            bt::error_stack().clear();
+        }
+    }
+}
+
+void BundleIndex::add(BundleID bundle_id, std::uint64_t size, std::vector<RBUNChunk> const& chunks) {
+    if (bundles_.contains(bundle_id)) {
+        forget({ bundle_id });
+    }
+    bundles_[bundle_id] = size;
+    for (uint32_t offset = 0; auto const& chunk: chunks) {
+        chunks_.emplace(chunk.id, Location { bundle_id, offset, chunk.compressed_size, chunk.uncompressed_size });
+        offset += chunk.compressed_size;
+    }
+    dirty_ = true;
+}
+
+std::vector<BundleIndex::Location> BundleIndex::find(ChunkID id) const {
+    auto result = std::vector<Location>{};
+    auto [i, end] = chunks_.equal_range(id);
+    for (; i != end; ++i) {
+        result.push_back(i->second);
+    }
+    return result;
+}
+
+void BundleIndex::save() {
+    if (!dirty_) {
+        return;
+    }
+    auto bundles = std::vector<IndexBundle>{};
+    bundles.reserve(bundles_.size());
+    for (auto const& [bundle_id, size]: bundles_) {
+        bundles.push_back({ bundle_id, size });
+    }
+    auto chunks = std::vector<IndexChunk>{};
+    chunks.reserve(chunks_.size());
+    for (auto const& [chunk_id, location]: chunks_) {
+        chunks.push_back({ chunk_id, location });
+    }
+    auto writer = BinWriter{};
+    writer.write(INDEX_MAGIC);
+    writer.write(INDEX_VERSION);
+    writer.write(bundles);
+    writer.write(chunks);
+    writer.save(path());
+    dirty_ = false;
+}
+
+fs::path BundleIndex::path() const {
+    return dir_ / u8"bundles.index";
+}
+
+bool BundleIndex::load() {
+    auto const path = this->path();
+    if (!fs::exists(path)) {
+        return false;
+    }
+    auto file = MMap<char const>{};
+    if (file.open(path)) {
+        return false;
+    }
+    auto reader = BinReader { file.span() };
+    auto magic = std::array<char, 4>{};
+    auto version = uint32_t{};
+    if (!reader.read(magic) || magic != INDEX_MAGIC) {
+        return false;
+    }
+    if (!reader.read(version) || version != INDEX_VERSION) {
+        return false;
+    }
+    auto bundles = std::vector<IndexBundle>{};
+    auto chunks = std::vector<IndexChunk>{};
+    if (!reader.read(bundles) || !reader.read(chunks) || !reader.data.empty()) {
+        return false;
+    }
+    for (auto const& bundle: bundles) {
+        bundles_[bundle.id] = bundle.size;
+    }
+    chunks_.reserve(chunks.size());
+    for (auto const& chunk: chunks) {
+        chunks_.emplace(chunk.id, chunk.location);
+    }
+    return true;
+}
+
+void BundleIndex::forget(std::unordered_set<BundleID> const& bundle_ids) {
+    if (bundle_ids.empty()) {
+        return;
+    }
+    for (auto bundle_id: bundle_ids) {
+        bundles_.erase(bundle_id);
+    }
+    std::erase_if(chunks_, [&](auto const& kvp) { return bundle_ids.contains(kvp.second.bundle_id); });
+    dirty_ = true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <common/fs.hpp>
+#include <file/rman/manifest.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace rman {
+    // Persistent map of ChunkID to its place in any local bundle, built from bundle footers.
+    struct BundleIndex {
+        struct Location {
+            BundleID bundle_id;
+            uint32_t compressed_offset;
+            uint32_t compressed_size;
+            uint32_t uncompressed_size;
+        };
+
+        BundleIndex(fs::path dir);
+        BundleIndex(BundleIndex const&) = delete;
+        BundleIndex& operator=(BundleIndex const&) = delete;
+        ~BundleIndex();
+
+        // Scans footers of bundles added since last scan and forgets removed ones.
+        void refresh();
+
+        void add(BundleID bundle_id, std::uint64_t size, std::vector<RBUNChunk> const& chunks);
+
+        // Every local copy of chunk, in no particular order.
+        std::vector<Location> find(ChunkID id) const;
+
+        void save();
+
+    private:
+        fs::path dir_;
+        bool dirty_ = false;
+        std::unordered_map<BundleID, std::uint64_t> bundles_;
+        // Every local copy of a chunk is kept, so removing one bundle leaves copies in others findable
+        std::unordered_multimap<ChunkID, Location> chunks_;
+
+        fs::path path() const;
+        bool load();
+        void forget(std::unordered_set<BundleID> const& bundle_ids);
+    };
+}
@@ -0,0 +1,207 @@
+#include <common/binfile.hpp>
+#include <common/bt_error.hpp>
+#include <common/filelock.hpp>
+#include <common/mmap.hpp>
+#include <file/rman/cacheusage.hpp>
+#include <chrono>
+#include <set>
+
+using namespace rman;
+
+static constexpr auto USAGE_MAGIC = std::array { 'R', 'C', 'U', 'S' };
+static constexpr auto USAGE_VERSION = uint32_t{1};
+static constexpr auto PINS_MAGIC = std::array { 'R', 'P', 'I', 'N' };
+static constexpr auto PINS_VERSION = uint32_t{1};
+
+namespace {
+    struct UsageEntry {
+        BundleID id;
+        std::uint32_t accessed;
+        std::uint32_t reserved;
+    };
+}
+
+std::uint32_t rman::access_time_now() noexcept {
+    auto const now = std::chrono::system_clock::now().time_since_epoch();
+    return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(now).count());
+}
+
+CacheUsage::CacheUsage(fs::path dir) : dir_(std::move(dir)) {
+    if (!load(path(), accessed_)) {
+        accessed_.clear();
+    }
+}
+
+CacheUsage::~CacheUsage() {
+    // Lost access times only make eviction less precise, mirror might be read only
+    try {
+        save();
+    } catch (std::exception const&) {
+        bt::error_stack().clear();
+    }
+}
+
+void CacheUsage::touch(BundleID bundle_id) {
+    auto const lock = std::lock_guard(mutex_);
+    accessed_[bundle_id] = access_time_now();
+    forgotten_.erase(bundle_id);
+    dirty_ = true;
+}
+
+std::uint32_t CacheUsage::accessed(BundleID bundle_id) const {
+    auto const lock = std::lock_guard(mutex_);
+    if (auto const i = accessed_.find(bundle_id); i != accessed_.end()) {
+        return i->second;
+    }
+    return 0;
+}
+
+void CacheUsage::forget(BundleID bundle_id) {
+    auto const lock = std::lock_guard(mutex_);
+    accessed_.erase(bundle_id);
+    forgotten_.insert(bundle_id);
+    dirty_ = true;
+}
+
+void CacheUsage::refresh() {
+    auto const lock = std::lock_guard(mutex_);
+    auto const path = this->path();
+    auto reader_lock = FileLock{};
+    // Without lock, as on read only mirror, times loaded at start still order eviction
+    if (reader_lock.lock(fs::path(path) += u8".lock")) {
+        return;
+    }
+    accessed_ = merged(path);
+}
+
+void CacheUsage::save() {
+    auto const lock = std::lock_guard(mutex_);
+    if (!dirty_) {
+        return;
+    }
+    auto const path = this->path();
+    auto writer_lock = FileLock{};
+    bt_rethrow(writer_lock.lock(fs::path(path) += u8".lock").unwrap());
+    auto merged = this->merged(path);
+    auto entries = std::vector<UsageEntry>{};
+    entries.reserve(merged.size());
+    for (auto const& [bundle_id, accessed]: merged) {
+        entries.push_back({ bundle_id, accessed, 0 });
+    }
+    auto writer = BinWriter{};
+    writer.write(USAGE_MAGIC);
+    writer.write(USAGE_VERSION);
+    writer.write(entries);
+    writer.save(path);
+    accessed_ = std::move(merged);
+    forgotten_.clear();
+    dirty_ = false;
+}
+
+// Saved times with own ones on top, newest time wins, caller holds file lock.
+std::unordered_map<BundleID, std::uint32_t> CacheUsage::merged(fs::path const& path) const {
+    auto result = std::unordered_map<BundleID, std::uint32_t>{};
+    if (!load(path, result)) {
+        result.clear();
+    }
+    for (auto const bundle_id: forgotten_) {
+        result.erase(bundle_id);
+    }
+    for (auto const& [bundle_id, accessed]: accessed_) {
+        auto& value = result[bundle_id];
+        value = std::max(value, accessed);
+    }
+    return result;
+}
+
+fs::path CacheUsage::path() const {
+    return dir_ / u8"cache.meta";
+}
+
+bool CacheUsage::load(fs::path const& path, std::unordered_map<BundleID, std::uint32_t>& out) {
+    if (!fs::exists(path)) {
+        return false;
+    }
+    auto file = MMap<char const>{};
+    if (file.open(path)) {
+        return false;
+    }
+    auto reader = BinReader { file.span() };
+    auto magic = std::array<char, 4>{};
+    auto version = uint32_t{};
+    if (!reader.read(magic) || magic != USAGE_MAGIC) {
+        return false;
+    }
+    if (!reader.read(version) || version != USAGE_VERSION) {
+        return false;
+    }
+    auto entries = std::vector<UsageEntry>{};
+    if (!reader.read(entries) || !reader.data.empty()) {
+        return false;
+    }
+    out.reserve(entries.size());
+    for (auto const& entry: entries) {
+        out[entry.id] = entry.accessed;
+    }
+    return true;
+}
+
+void CachePins::retain(fs::path const& dir, std::span<RMANManifest const> manifests) {
+    auto const pins_dir = dir / u8"retained";
+    auto keep = std::set<fs::path>{};
+    for (auto const& manifest: manifests) {
+        auto bundles = std::vector<BundleID>{};
+        auto chunks = std::vector<ChunkID>{};
+        bundles.reserve(manifest.bundles.size());
+        for (auto const& bundle: manifest.bundles) {
+            bundles.push_back(bundle.id);
+            for (auto const& chunk: bundle.chunks) {
+                chunks.push_back(chunk.id);
+            }
+        }
+        auto writer = BinWriter{};
+        writer.write(PINS_MAGIC);
+        writer.write(PINS_VERSION);
+        writer.write(bundles);
+        writer.write(chunks);
+        auto path = pins_dir / fmt::format(u8"{:016X}.pins", manifest.id);
+        writer.save(path);
+        keep.insert(std::move(path));
+    }
+    if (!fs::exists(pins_dir)) {
+        return;
+    }
+    for (auto const& file: fs::directory_iterator(pins_dir)) {
+        if (file.path().extension() == u8".pins" && !keep.contains(file.path())) {
+            bt_rethrow(fs::remove(file.path()));
+        }
+    }
+}
+
+CachePins CachePins::load(fs::path const& dir) {
+    auto result = CachePins{};
+    auto const pins_dir = dir / u8"retained";
+    if (!fs::exists(pins_dir)) {
+        return result;
+    }
+    for (auto const& file: fs::directory_iterator(pins_dir)) {
+        if (file.path().extension() != u8".pins") {
+            continue;
+        }
+        bt_trace(u8"pins: {}", file.path().generic_u8string());
+        auto mapped = MMap<char const>{};
+        bt_rethrow(mapped.open(file.path()).unwrap());
+        auto reader = BinReader { mapped.span() };
+        auto magic = std::array<char, 4>{};
+        auto version = uint32_t{};
+        auto bundles = std::vector<BundleID>{};
+        auto chunks = std::vector<ChunkID>{};
+        // Unreadable pins would let gc drop what they guard, refuse instead
+        bt_assert(reader.read(magic) && magic == PINS_MAGIC);
+        bt_assert(reader.read(version) && version == PINS_VERSION);
+        bt_assert(reader.read(bundles) && reader.read(chunks) && reader.data.empty());
+        result.bundles.insert(bundles.begin(), bundles.end());
+        result.chunks.insert(chunks.begin(), chunks.end());
+    }
+    return result;
+}
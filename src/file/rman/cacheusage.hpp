@@ -0,0 +1,55 @@
+#pragma once
+#include <common/fs.hpp>
+#include <file/rman/manifest.hpp>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace rman {
+    // Seconds since epoch, coarse enough for LRU and small enough to fit index slots.
+    std::uint32_t access_time_now() noexcept;
+
+    // Persistent last access time of each local bundle, drives LRU eviction.
+    struct CacheUsage {
+        CacheUsage(fs::path dir);
+        CacheUsage(CacheUsage const&) = delete;
+        CacheUsage& operator=(CacheUsage const&) = delete;
+        ~CacheUsage();
+
+        void touch(BundleID bundle_id);
+
+        // Zero when bundle was never seen, those go first.
+        std::uint32_t accessed(BundleID bundle_id) const;
+
+        void forget(BundleID bundle_id);
+
+        // Takes in times other processes saved since this one loaded, so eviction ranks by newest use.
+        void refresh();
+
+        // Merges with times other processes saved meanwhile, newest time wins.
+        void save();
+
+    private:
+        fs::path dir_;
+        mutable std::mutex mutex_;
+        bool dirty_ = false;
+        std::unordered_map<BundleID, std::uint32_t> accessed_;
+        std::unordered_set<BundleID> forgotten_;
+
+        fs::path path() const;
+        static bool load(fs::path const& path, std::unordered_map<BundleID, std::uint32_t>& out);
+        std::unordered_map<BundleID, std::uint32_t> merged(fs::path const& path) const;
+    };
+
+    // Bundles and chunks of retained manifests, neither eviction nor gc drops them.
+    struct CachePins {
+        std::unordered_set<BundleID> bundles;
+        std::unordered_set<ChunkID> chunks;
+
+        // Replaces retained set of cache in dir with given manifests.
+        static void retain(fs::path const& dir, std::span<RMANManifest const> manifests);
+
+        static CachePins load(fs::path const& dir);
+    };
+}
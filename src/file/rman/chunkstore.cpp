@@ -0,0 +1,525 @@
+#include <common/bt_error.hpp>
+#include <common/filelock.hpp>
+#include <file/rman/cacheusage.hpp>
+#include <file/rman/chunkstore.hpp>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cstring>
+
+using namespace rman;
+
+namespace {
+    struct IndexHeader {
+        std::array<char, 4> magic;
+        std::uint32_t version;
+        std::uint64_t capacity;
+        std::uint64_t count;
+        std::uint32_t segment_first;
+        std::uint32_t segment_count;
+        // Set once file was replaced by grow or compact, other processes reopen it then
+        std::uint64_t retired;
+    };
+
+    struct IndexEntry {
+        ChunkID id;
+        std::uint32_t segment;
+        std::uint32_t size;
+        std::uint64_t offset;
+        std::uint32_t flags;
+        // Seconds since epoch of last get or put, zero when unknown
+        std::uint32_t accessed;
+    };
+
+    // Records carry their ids so index can be rebuilt from segments alone
+    struct RecordHeader {
+        ChunkID id;
+        std::uint32_t size;
+        std::uint32_t flags;
+    };
+
+    constexpr std::uint32_t FLAG_COMPRESSED = 1;
+    constexpr auto MAGIC = std::array { 'R', 'C', 'P', 'K' };
+    constexpr std::uint32_t VERSION = 3;
+    constexpr std::uint64_t MIN_CAPACITY = 4096;
+    constexpr std::uint64_t SEGMENT_LIMIT = 1024ull * 1024 * 1024;
+    constexpr std::size_t BATCH_LIMIT = 64 * 1024 * 1024;
+
+    IndexHeader const& header_of(std::span<char const> index) noexcept {
+        return *reinterpret_cast<IndexHeader const*>(index.data());
+    }
+
+    IndexHeader& header_of(std::span<char> index) noexcept {
+        return *reinterpret_cast<IndexHeader*>(index.data());
+    }
+
+    std::span<IndexEntry const> entries_of(std::span<char const> index) noexcept {
+        auto const data = reinterpret_cast<IndexEntry const*>(index.data() + sizeof(IndexHeader));
+        return { data, static_cast<std::size_t>(header_of(index).capacity) };
+    }
+
+    std::span<IndexEntry> entries_of(std::span<char> index) noexcept {
+        auto const data = reinterpret_cast<IndexEntry*>(index.data() + sizeof(IndexHeader));
+        return { data, static_cast<std::size_t>(header_of(index).capacity) };
+    }
+
+    bool is_valid(std::span<char const> index) noexcept {
+        if (index.size() < sizeof(IndexHeader)) {
+            return false;
+        }
+        auto const& header = header_of(index);
+        return header.magic == MAGIC
+            && header.version == VERSION
+            && header.capacity >= MIN_CAPACITY
+            && std::has_single_bit(header.capacity)
+            && header.count * 2 <= header.capacity
+            && index.size() == sizeof(IndexHeader) + header.capacity * sizeof(IndexEntry);
+    }
+
+    // Index is mapped shared, other processes insert while we probe
+    ChunkID load_id(IndexEntry const& entry) noexcept {
+        return std::atomic_ref(const_cast<ChunkID&>(entry.id)).load(std::memory_order_acquire);
+    }
+
+    bool is_retired(std::span<char const> index) noexcept {
+        auto& retired = const_cast<std::uint64_t&>(header_of(index).retired);
+        return std::atomic_ref(retired).load(std::memory_order_acquire) != 0;
+    }
+
+    void retire(std::span<char> index) noexcept {
+        std::atomic_ref(header_of(index).retired).store(1, std::memory_order_release);
+    }
+
+    IndexEntry const* find(std::span<char const> index, ChunkID id) noexcept {
+        if (index.empty()) {
+            return nullptr;
+        }
+        auto const entries = entries_of(index);
+        auto const mask = entries.size() - 1;
+        for (auto slot = static_cast<std::size_t>(id) & mask;; slot = (slot + 1) & mask) {
+            auto const slot_id = load_id(entries[slot]);
+            if (slot_id == id) {
+                return &entries[slot];
+            }
+            if (slot_id == ChunkID::None) {
+                return nullptr;
+            }
+        }
+    }
+
+    // Id is written last so readers never see half written entry, first copy of a chunk wins.
+    void insert(std::span<char> index, IndexEntry const& entry) noexcept {
+        auto const entries = entries_of(index);
+        auto const mask = entries.size() - 1;
+        for (auto slot = static_cast<std::size_t>(entry.id) & mask;; slot = (slot + 1) & mask) {
+            if (entries[slot].id == entry.id) {
+                return;
+            }
+            if (entries[slot].id == ChunkID::None) {
+                entries[slot].segment = entry.segment;
+                entries[slot].size = entry.size;
+                entries[slot].offset = entry.offset;
+                entries[slot].flags = entry.flags;
+                entries[slot].accessed = entry.accessed;
+                std::atomic_ref(entries[slot].id).store(entry.id, std::memory_order_release);
+                header_of(index).count++;
+                return;
+            }
+        }
+    }
+
+    void create_index(fs::path const& path, MMap<char>& index, std::uint64_t capacity,
+                      std::uint32_t segment_first, std::uint32_t segment_count) {
+        bt_trace(u8"path: {}", path.generic_u8string());
+        auto error = std::error_code{};
+        fs::remove(path, error);
+        bt_rethrow(index.create(path, sizeof(IndexHeader) + capacity * sizeof(IndexEntry)).unwrap());
+        header_of(index.span()) = IndexHeader { MAGIC, VERSION, capacity, 0, segment_first, segment_count, 0 };
+    }
+
+    std::uint64_t capacity_for(std::uint64_t count, std::uint64_t capacity = MIN_CAPACITY) noexcept {
+        while (count * 2 > capacity) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void append_record(std::vector<char>& records, ChunkID id, std::span<char const> data, std::uint32_t flags) {
+        auto const record = RecordHeader { id, static_cast<std::uint32_t>(data.size()), flags };
+        auto const offset = records.size();
+        records.resize(offset + sizeof(RecordHeader) + data.size());
+        std::memcpy(records.data() + offset, &record, sizeof(RecordHeader));
+        std::memcpy(records.data() + offset + sizeof(RecordHeader), data.data(), data.size());
+    }
+}
+
+ChunkStore::ChunkStore(fs::path dir) : dir_(std::move(dir)) {
+    open_index();
+}
+
+ChunkStore::~ChunkStore() {
+    // Chunks that did not make it to disk are only refetched later
+    try {
+        flush();
+    } catch (std::exception const&) {
+        bt::error_stack().clear();
+    }
+}
+
+bool ChunkStore::contains(ChunkID id) {
+    auto const lock = std::lock_guard(mutex_);
+    refresh_index();
+    return pending_.contains(id) || find(index_view(), id);
+}
+
+std::optional<ChunkStore::Chunk> ChunkStore::get(ChunkID id) {
+    auto const lock = std::lock_guard(mutex_);
+    refresh_index();
+    if (pending_.contains(id)) {
+        flush_locked();
+    }
+    auto const entry = find(index_view(), id);
+    if (!entry) {
+        return std::nullopt;
+    }
+    // Only rewrite when stale so hot chunks do not dirty index pages on every read
+    if (auto const now = access_time_now(); index_ && now - entry->accessed >= TOUCH_INTERVAL) {
+        auto& accessed = const_cast<std::uint32_t&>(entry->accessed);
+        std::atomic_ref(accessed).store(now, std::memory_order_relaxed);
+    }
+    return Chunk {
+        map_segment(entry->segment, entry->offset, entry->size),
+        (entry->flags & FLAG_COMPRESSED) != 0,
+    };
+}
+
+void ChunkStore::put(ChunkID id, std::span<char const> data, bool compressed) {
+    auto const lock = std::lock_guard(mutex_);
+    if (pending_.contains(id) || find(index_view(), id)) {
+        return;
+    }
+    pending_[id] = pending_data_.size();
+    append_record(pending_data_, id, data, compressed ? FLAG_COMPRESSED : 0);
+    if (pending_data_.size() >= BATCH_LIMIT) {
+        flush_locked();
+    }
+}
+
+void ChunkStore::flush() {
+    auto const lock = std::lock_guard(mutex_);
+    flush_locked();
+}
+
+std::size_t ChunkStore::compact(std::function<bool(ChunkID)> const& keep) {
+    auto const lock = std::lock_guard(mutex_);
+    flush_locked();
+    if (!fs::exists(dir_)) {
+        return 0;
+    }
+    auto const writer = lock_writers();
+    refresh_index(true);
+    auto const view = index_view();
+    if (view.empty()) {
+        return 0;
+    }
+    bt_assert(index_);
+    auto const old_first = header_of(view).segment_first;
+    auto const new_first = old_first + header_of(view).segment_count;
+    auto kept = std::vector<IndexEntry>{};
+    auto reclaimed = std::size_t{};
+    for (auto const& entry: entries_of(view)) {
+        if (entry.id == ChunkID::None) {
+            continue;
+        }
+        if (keep(entry.id)) {
+            kept.push_back(entry);
+        } else {
+            reclaimed += sizeof(RecordHeader) + entry.size;
+        }
+    }
+    // Copy in segment order so old segments are read sequentially
+    std::sort(kept.begin(), kept.end(), [](IndexEntry const& lhs, IndexEntry const& rhs) {
+        return std::tie(lhs.segment, lhs.offset) < std::tie(rhs.segment, rhs.offset);
+    });
+    auto const tmp_path = fs::path(index_path()) += u8".tmp";
+    auto tmp = MMap<char>{};
+    create_index(tmp_path, tmp, capacity_for(kept.size()), new_first, 0);
+    auto records = std::vector<char>{};
+    for (auto const& entry: kept) {
+        append_record(records, entry.id, map_segment(entry.segment, entry.offset, entry.size), entry.flags);
+        if (records.size() >= BATCH_LIMIT) {
+            write_records(tmp, records);
+            records.clear();
+        }
+    }
+    if (!records.empty()) {
+        write_records(tmp, records);
+    }
+    for (auto const& entry: kept) {
+        const_cast<IndexEntry*>(find(tmp.span(), entry.id))->accessed = entry.accessed;
+    }
+    bt_rethrow(tmp.close().unwrap());
+    bt_rethrow(fs::rename(tmp_path, index_path()));
+    retire(index_.span());
+    segments_.clear();
+    retired_.clear();
+    index_ = {};
+    index_read_only_ = {};
+    for (auto segment = old_first; segment != new_first; ++segment) {
+        auto error = std::error_code{};
+        fs::remove(segment_path(segment), error);
+    }
+    open_index(true);
+    return reclaimed;
+}
+
+std::vector<ChunkStore::Entry> ChunkStore::entries() {
+    auto const lock = std::lock_guard(mutex_);
+    flush_locked();
+    refresh_index();
+    auto result = std::vector<Entry>{};
+    auto const view = index_view();
+    if (view.empty()) {
+        return result;
+    }
+    result.reserve(static_cast<std::size_t>(header_of(view).count));
+    for (auto const& entry: entries_of(view)) {
+        if (auto const id = load_id(entry); id != ChunkID::None) {
+            result.push_back({ id, sizeof(RecordHeader) + entry.size, entry.accessed });
+        }
+    }
+    return result;
+}
+
+std::uint64_t ChunkStore::size_on_disk() {
+    auto const lock = std::lock_guard(mutex_);
+    auto result = std::uint64_t{};
+    if (!fs::exists(dir_)) {
+        return result;
+    }
+    for (auto const& file: fs::directory_iterator(dir_)) {
+        if (file.is_regular_file()) {
+            result += file.file_size();
+        }
+    }
+    return result;
+}
+
+fs::path ChunkStore::index_path() const {
+    return dir_ / u8"chunks.idx";
+}
+
+fs::path ChunkStore::lock_path() const {
+    return dir_ / u8"chunks.lock";
+}
+
+fs::path ChunkStore::segment_path(std::uint32_t segment) const {
+    return dir_ / fmt::format(u8"{:08X}.pack", segment);
+}
+
+std::span<char const> ChunkStore::index_view() const noexcept {
+    if (index_) {
+        return index_.span();
+    }
+    return index_read_only_.span();
+}
+
+std::span<char const> ChunkStore::map_segment(std::uint32_t segment, std::uint64_t offset, std::uint32_t size) {
+    bt_trace(u8"segment: {:08X}", segment);
+    auto& file = segments_[segment];
+    if (!file || file.size() < offset + size) {
+        // Segment grew since it was mapped, keep old view alive for spans handed out before
+        if (file) {
+            retired_.push_back(std::move(file));
+        }
+        bt_rethrow(file.open(segment_path(segment)).unwrap());
+        bt_assert(file.size() >= offset + size);
+    }
+    return file.span().subspan(static_cast<std::size_t>(offset), size);
+}
+
+void ChunkStore::open_index(bool is_writer) {
+    if (try_open_index()) {
+        return;
+    }
+    if (fs::exists(dir_)) {
+        try {
+            auto const writer = is_writer ? FileLock{} : lock_writers();
+            // Another process may have rebuilt it while we waited
+            if (!try_open_index()) {
+                rebuild_index();
+            }
+        } catch (std::exception const&) {
+            bt::error_stack().clear();
+            index_ = {};
+        }
+    }
+}
+
+bool ChunkStore::try_open_index() {
+    index_ = {};
+    index_read_only_ = {};
+    auto const path = index_path();
+    if (!fs::exists(path)) {
+        return false;
+    }
+    // Mirror might be read only, lookups still work then
+    if (index_.open(path)) {
+        bt_rethrow(index_read_only_.open(path).unwrap());
+    }
+    if (is_valid(index_view())) {
+        return true;
+    }
+    index_ = {};
+    index_read_only_ = {};
+    return false;
+}
+
+void ChunkStore::refresh_index(bool is_writer) {
+    auto const view = index_view();
+    if (view.empty() ? fs::exists(index_path()) : is_retired(view)) {
+        open_index(is_writer);
+    }
+}
+
+FileLock ChunkStore::lock_writers() {
+    auto result = FileLock{};
+    bt_rethrow(result.lock(lock_path()).unwrap());
+    return result;
+}
+
+void ChunkStore::rebuild_index() {
+    auto segments = std::vector<std::uint32_t>{};
+    for (auto const& file: fs::directory_iterator(dir_)) {
+        auto const name = file.path().filename().generic_string();
+        auto segment = std::uint32_t{};
+        if (name.size() == 13 && name.ends_with(".pack")) {
+            auto const result = std::from_chars(name.data(), name.data() + 8, segment, 16);
+            if (result.ec == std::errc{} && result.ptr == name.data() + 8) {
+                segments.push_back(segment);
+            }
+        }
+    }
+    if (segments.empty()) {
+        return;
+    }
+    std::sort(segments.begin(), segments.end());
+    auto entries = std::vector<IndexEntry>{};
+    for (auto const segment: segments) {
+        auto& file = segments_[segment];
+        bt_rethrow(file.open(segment_path(segment)).unwrap());
+        auto const data = file.span();
+        for (std::size_t offset = 0; offset + sizeof(RecordHeader) <= data.size();) {
+            auto record = RecordHeader{};
+            std::memcpy(&record, data.data() + offset, sizeof(RecordHeader));
+            auto const begin = offset + sizeof(RecordHeader);
+            // Torn tail from interrupted write
+            if (record.id == ChunkID::None || data.size() - begin < record.size) {
+                break;
+            }
+            entries.push_back({ record.id, segment, record.size, begin, record.flags, 0 });
+            offset = begin + record.size;
+        }
+    }
+    auto const segment_count = segments.back() - segments.front() + 1;
+    create_index(index_path(), index_, capacity_for(entries.size()), segments.front(), segment_count);
+    for (auto const& entry: entries) {
+        insert(index_.span(), entry);
+    }
+    index_.sync();
+}
+
+void ChunkStore::reserve(std::uint64_t count) {
+    auto const view = index_view();
+    auto const capacity = view.empty() ? 0 : header_of(view).capacity;
+    if (index_ && count * 2 <= capacity) {
+        return;
+    }
+    auto const tmp_path = fs::path(index_path()) += u8".tmp";
+    auto tmp = MMap<char>{};
+    if (view.empty()) {
+        create_index(tmp_path, tmp, capacity_for(count), 0, 0);
+    } else {
+        auto const& header = header_of(view);
+        create_index(tmp_path, tmp, capacity_for(count, capacity), header.segment_first, header.segment_count);
+        for (auto const& entry: entries_of(view)) {
+            if (entry.id != ChunkID::None) {
+                insert(tmp.span(), entry);
+            }
+        }
+    }
+    bt_rethrow(tmp.close().unwrap());
+    bt_rethrow(fs::rename(tmp_path, index_path()));
+    if (index_) {
+        retire(index_.span());
+    }
+    index_ = {};
+    index_read_only_ = {};
+    bt_rethrow(index_.open(index_path()).unwrap());
+}
+
+void ChunkStore::write_records(MMap<char>& index, std::span<char const> records) {
+    auto& header = header_of(index.span());
+    if (!header.segment_count) {
+        header.segment_count = 1;
+    }
+    auto segment = header.segment_first + header.segment_count - 1;
+    auto offset = std::uint64_t{};
+    if (auto const path = segment_path(segment); fs::exists(path)) {
+        offset = fs::file_size(path);
+    }
+    if (offset && offset + records.size() > SEGMENT_LIMIT) {
+        ++segment;
+        ++header.segment_count;
+        offset = 0;
+    }
+    if (auto file = segments_.find(segment); file != segments_.end() && file->second) {
+        retired_.push_back(std::move(file->second));
+    }
+    auto out = MMap<char>{};
+    bt_rethrow(out.create(segment_path(segment), offset + records.size()).unwrap());
+    std::memcpy(out.data() + offset, records.data(), records.size());
+    bt_rethrow(out.close().unwrap());
+    // Index only learns about records once their bytes are on disk
+    auto const now = access_time_now();
+    for (std::size_t position = 0; position != records.size();) {
+        auto record = RecordHeader{};
+        std::memcpy(&record, records.data() + position, sizeof(RecordHeader));
+        auto const begin = position + sizeof(RecordHeader);
+        insert(index.span(), { record.id, segment, record.size, offset + begin, record.flags, now });
+        position = begin + record.size;
+    }
+    index.sync();
+}
+
+void ChunkStore::flush_locked() {
+    if (pending_.empty()) {
+        return;
+    }
+    bt_rethrow(fs::create_directories(dir_));
+    auto const writer = lock_writers();
+    refresh_index(true);
+    // Other processes may have stored some of these since they were put
+    auto const view = index_view();
+    auto const is_stored = [&](auto const& kvp) { return find(view, kvp.first) != nullptr; };
+    if (std::any_of(pending_.begin(), pending_.end(), is_stored)) {
+        auto records = std::vector<char>{};
+        for (std::size_t position = 0; position != pending_data_.size();) {
+            auto record = RecordHeader{};
+            std::memcpy(&record, pending_data_.data() + position, sizeof(RecordHeader));
+            auto const end = position + sizeof(RecordHeader) + record.size;
+            if (!find(view, record.id)) {
+                records.insert(records.end(), pending_data_.begin() + position, pending_data_.begin() + end);
+            }
+            position = end;
+        }
+        pending_data_ = std::move(records);
+    }
+    if (!pending_data_.empty()) {
+        reserve((view.empty() ? 0 : header_of(view).count) + pending_.size());
+        write_records(index_, pending_data_);
+    }
+    pending_data_.clear();
+    pending_.clear();
+}
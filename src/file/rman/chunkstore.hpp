@@ -0,0 +1,81 @@
+#pragma once
+#include <common/filelock.hpp>
+#include <common/fs.hpp>
+#include <common/mmap.hpp>
+#include <file/rman/manifest.hpp>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace rman {
+    // Append only chunk pack: segment files hold chunk records back to back,
+    // mmapped open addressing index maps ChunkID to (segment, offset, size).
+    // Several processes can share one store, writers take turns through lock file.
+    struct ChunkStore {
+        // Index refreshes access time of a chunk at most this often, in seconds
+        static constexpr std::uint32_t TOUCH_INTERVAL = 60;
+
+        struct Chunk {
+            std::span<char const> data;
+            // Data is the original zstd frame instead of uncompressed bytes
+            bool compressed;
+        };
+
+        ChunkStore(fs::path dir);
+        ChunkStore(ChunkStore const&) = delete;
+        ChunkStore& operator=(ChunkStore const&) = delete;
+        ~ChunkStore();
+
+        struct Entry {
+            ChunkID id;
+            // Bytes compact reclaims when chunk is dropped
+            std::uint64_t size;
+            std::uint32_t accessed;
+        };
+
+        bool contains(ChunkID id);
+
+        // Span points into segment mapping and stays valid until compact or destruction.
+        std::optional<Chunk> get(ChunkID id);
+
+        // Chunks are buffered and written out in batches by flush.
+        void put(ChunkID id, std::span<char const> data, bool compressed = false);
+
+        void flush();
+
+        std::vector<Entry> entries();
+
+        // Segments, index and lock file together.
+        std::uint64_t size_on_disk();
+
+        // Rewrites chunks that pass keep into new segments and drops old segments, returns bytes reclaimed.
+        std::size_t compact(std::function<bool(ChunkID)> const& keep);
+
+    private:
+        fs::path dir_;
+        std::mutex mutex_;
+        MMap<char> index_;
+        MMap<char const> index_read_only_;
+        std::map<std::uint32_t, MMap<char const>> segments_;
+        std::vector<MMap<char const>> retired_;
+        std::vector<char> pending_data_;
+        std::unordered_map<ChunkID, std::size_t> pending_;
+
+        fs::path index_path() const;
+        fs::path lock_path() const;
+        fs::path segment_path(std::uint32_t segment) const;
+        std::span<char const> index_view() const noexcept;
+        std::span<char const> map_segment(std::uint32_t segment, std::uint64_t offset, std::uint32_t size);
+        // Writer lock is not reentrant, holders pass is_writer so it is not taken twice
+        void open_index(bool is_writer = false);
+        bool try_open_index();
+        void refresh_index(bool is_writer = false);
+        FileLock lock_writers();
+        void rebuild_index();
+        void reserve(std::uint64_t count);
+        void write_records(MMap<char>& index, std::span<char const> records);
+        void flush_locked();
+    };
+}
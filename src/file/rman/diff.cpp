@@ -0,0 +1,117 @@
+#include <file/rman/diff.hpp>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace rman;
+
+static bool same_content(FileInfo const& lhs, FileInfo const& rhs) noexcept {
+    return lhs.size == rhs.size
+        && lhs.link == rhs.link
+        && std::equal(lhs.chunks.begin(), lhs.chunks.end(), rhs.chunks.begin(), rhs.chunks.end(),
+                      [](FileChunk const& l, FileChunk const& r) { return l.id == r.id; });
+}
+
+ManifestDiff ManifestDiff::compute(std::vector<FileInfo> old_files, std::vector<FileInfo> new_files) {
+    auto result = ManifestDiff{ std::move(old_files), std::move(new_files), {}, {}, {} };
+    auto const& olds = result.old_files;
+    auto const& news = result.new_files;
+    auto& entries = result.entries;
+
+    auto old_by_path = std::unordered_map<std::u8string_view, std::size_t>{};
+    old_by_path.reserve(olds.size());
+    for (std::size_t index = 0; index != olds.size(); ++index) {
+        old_by_path.emplace(olds[index].path, index);
+    }
+    auto old_matched = std::vector<bool>(olds.size());
+    auto unmatched_new = std::vector<std::size_t>{};
+    for (std::size_t index = 0; index != news.size(); ++index) {
+        auto const i = old_by_path.find(news[index].path);
+        if (i == old_by_path.end()) {
+            unmatched_new.push_back(index);
+            continue;
+        }
+        old_matched[i->second] = true;
+        if (!same_content(olds[i->second], news[index])) {
+            entries.push_back({ Change::Modified, i->second, index });
+        }
+    }
+
+    // Files without chunks all look alike, renaming them tells nothing
+    auto old_by_first_chunk = std::unordered_multimap<ChunkID, std::size_t>{};
+    for (std::size_t index = 0; index != olds.size(); ++index) {
+        if (!old_matched[index] && !olds[index].chunks.empty()) {
+            old_by_first_chunk.emplace(olds[index].chunks.front().id, index);
+        }
+    }
+    for (auto const index: unmatched_new) {
+        auto const& file = news[index];
+        auto renamed_from = npos;
+        if (!file.chunks.empty()) {
+            auto [i, end] = old_by_first_chunk.equal_range(file.chunks.front().id);
+            for (; i != end; ++i) {
+                if (same_content(olds[i->second], file)) {
+                    renamed_from = i->second;
+                    old_by_first_chunk.erase(i);
+                    break;
+                }
+            }
+        }
+        if (renamed_from != npos) {
+            old_matched[renamed_from] = true;
+            entries.push_back({ Change::Renamed, renamed_from, index });
+        } else {
+            entries.push_back({ Change::Added, npos, index });
+        }
+    }
+    for (std::size_t index = 0; index != olds.size(); ++index) {
+        if (!old_matched[index]) {
+            entries.push_back({ Change::Removed, index, npos });
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [&](Entry const& lhs, Entry const& rhs) {
+        auto const& lhs_path = lhs.new_index != npos ? news[lhs.new_index].path : olds[lhs.old_index].path;
+        auto const& rhs_path = rhs.new_index != npos ? news[rhs.new_index].path : olds[rhs.old_index].path;
+        return lhs_path < rhs_path;
+    });
+
+    auto old_chunks = std::unordered_set<ChunkID>{};
+    for (auto const& file: olds) {
+        for (auto const& chunk: file.chunks) {
+            old_chunks.insert(chunk.id);
+        }
+    }
+    auto seen = std::unordered_set<ChunkID>{};
+    for (auto const& entry: entries) {
+        if (entry.change != Change::Added && entry.change != Change::Modified) {
+            continue;
+        }
+        for (auto const& chunk: news[entry.new_index].chunks) {
+            if (!old_chunks.contains(chunk.id) && seen.insert(chunk.id).second) {
+                result.new_chunks.push_back(chunk);
+            }
+        }
+    }
+    std::sort(result.new_chunks.begin(), result.new_chunks.end(), [](FileChunk const& lhs, FileChunk const& rhs) {
+        return std::tie(lhs.bundle_id, lhs.compressed_offset) < std::tie(rhs.bundle_id, rhs.compressed_offset);
+    });
+    for (auto const& chunk: result.new_chunks) {
+        if (result.new_bundles.empty() || result.new_bundles.back() != chunk.bundle_id) {
+            result.new_bundles.push_back(chunk.bundle_id);
+        }
+    }
+    return result;
+}
+
+std::u8string_view ManifestDiff::name(Change change) noexcept {
+    switch (change) {
+    case Change::Added:
+        return u8"added";
+    case Change::Removed:
+        return u8"removed";
+    case Change::Modified:
+        return u8"modified";
+    case Change::Renamed:
+        return u8"renamed";
+    }
+    return u8"unknown";
+}
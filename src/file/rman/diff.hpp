@@ -0,0 +1,36 @@
+#pragma once
+#include <file/rman/manifest.hpp>
+
+namespace rman {
+    // What changed between two file lists and which chunks the newer one needs that older one lacks.
+    struct ManifestDiff {
+        enum class Change : std::uint8_t {
+            Added,
+            Removed,
+            Modified,
+            Renamed,
+        };
+
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        struct Entry {
+            Change change;
+            // Indexes into old_files and new_files, npos for side file is missing from
+            std::size_t old_index;
+            std::size_t new_index;
+        };
+
+        std::vector<FileInfo> old_files;
+        std::vector<FileInfo> new_files;
+        // Unchanged files are left out, sorted by path
+        std::vector<Entry> entries;
+        // Unique chunks of new files missing from old files, sorted by bundle then offset
+        std::vector<FileChunk> new_chunks;
+        std::vector<BundleID> new_bundles;
+
+        // Files with same path are compared by chunk id sequence, leftover files with same content are renames.
+        static ManifestDiff compute(std::vector<FileInfo> old_files, std::vector<FileInfo> new_files);
+
+        static std::u8string_view name(Change change) noexcept;
+    };
+}
@@ -0,0 +1,180 @@
+#include <common/bt_error.hpp>
+#include <file/rman/download.hpp>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <curl/curl.h>
+
+using namespace rman;
+
+static constexpr int MAX_ATTEMPTS = 6;
+static constexpr auto BACKOFF_FIRST = std::chrono::milliseconds(500);
+static constexpr auto BACKOFF_LAST = std::chrono::milliseconds(8000);
+
+namespace {
+    struct FileSink {
+        CURL* curl;
+        fs::path const& path;
+        std::uint64_t offset;
+        std::ofstream out = {};
+        std::uint64_t received = 0;
+        bool started = false;
+
+        static size_t write(char const* p, size_t s, size_t n, FileSink* o) noexcept {
+            s *= n;
+            if (!o->started) {
+                o->started = true;
+                // Server is free to ignore range and send whole resource instead
+                long status = 0;
+                curl_easy_getinfo(o->curl, CURLINFO_RESPONSE_CODE, &status);
+                if (o->offset != 0 && status != 206) {
+                    o->out.close();
+                    o->out.open(o->path, std::ios::binary | std::ios::trunc);
+                    o->offset = 0;
+                }
+            }
+            if (!o->out.write(p, static_cast<std::streamsize>(s))) {
+                return 0;
+            }
+            o->received += s;
+            return s;
+        }
+    };
+
+    struct RangeSink {
+        CURL* curl;
+        std::vector<char>& out;
+        std::size_t size;
+        bool unsupported = false;
+        bool started = false;
+
+        static size_t write(char const* p, size_t s, size_t n, RangeSink* o) noexcept {
+            s *= n;
+            if (!o->started) {
+                o->started = true;
+                long status = 0;
+                curl_easy_getinfo(o->curl, CURLINFO_RESPONSE_CODE, &status);
+                if (status != 206) {
+                    // Abort instead of pulling whole resource into memory
+                    o->unsupported = true;
+                    return 0;
+                }
+            }
+            if (o->out.size() + s > o->size) {
+                return 0;
+            }
+            o->out.insert(o->out.end(), p, p + s);
+            return s;
+        }
+    };
+
+    // Client errors will not go away by asking again
+    bool is_retryable(CURLcode result, long status) noexcept {
+        switch (result) {
+        case CURLE_OK:
+        case CURLE_WRITE_ERROR:
+        case CURLE_URL_MALFORMAT:
+        case CURLE_UNSUPPORTED_PROTOCOL:
+            return false;
+        case CURLE_HTTP_RETURNED_ERROR:
+            return status >= 500 || status == 408 || status == 429;
+        default:
+            return true;
+        }
+    }
+
+    template <typename Func>
+    void with_retries(CURL* curl, std::u8string const& url, Func&& attempt) {
+        auto backoff = std::chrono::milliseconds(BACKOFF_FIRST);
+        for (int i = 1;; ++i) {
+            auto const result = attempt();
+            long status = 0;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+            if (result == CURLE_OK || !is_retryable(result, status) || i == MAX_ATTEMPTS) {
+                bt_trace(u8"url: {}", url);
+                bt_trace("curl error: {} (http {}, attempt {})", curl_easy_strerror(result), status, i);
+                bt_assert(result == CURLE_OK);
+                return;
+            }
+            std::this_thread::sleep_for(backoff);
+            backoff = std::min(backoff * 2, std::chrono::milliseconds(BACKOFF_LAST));
+        }
+    }
+}
+
+Download::Download() {
+    bt_assert(curl_ = curl_easy_init());
+    bt_assert(curl_easy_setopt(curl_, CURLOPT_VERBOSE, 0) == CURLE_OK);
+    bt_assert(curl_easy_setopt(curl_, CURLOPT_NOPROGRESS, 1L) == CURLE_OK);
+    bt_assert(curl_easy_setopt(curl_, CURLOPT_FAILONERROR, 1L) == CURLE_OK);
+    // Stalled connection counts as failed so it gets retried instead of hanging forever
+    curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT, 30L);
+    curl_easy_setopt(curl_, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl_, CURLOPT_LOW_SPEED_TIME, 60L);
+}
+
+Download::~Download() {
+    curl_easy_cleanup(curl_);
+}
+
+std::uint64_t Download::fetch(std::u8string const& url, fs::path const& part_path) {
+    auto received = std::uint64_t{};
+    curl_easy_setopt(curl_, CURLOPT_URL, (char const*)(url.c_str()));
+    curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &FileSink::write);
+    with_retries(curl_, url, [&] {
+        auto error = std::error_code{};
+        auto const offset = fs::exists(part_path, error) ? fs::file_size(part_path, error) : 0;
+        auto sink = FileSink { curl_, part_path, error ? 0 : offset };
+        sink.out.open(part_path, std::ios::binary | (sink.offset ? std::ios::app : std::ios::trunc));
+        if (!sink.out) {
+            return CURLE_WRITE_ERROR;
+        }
+        auto const range = fmt::format("{}-", sink.offset);
+        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &sink);
+        curl_easy_setopt(curl_, CURLOPT_RANGE, sink.offset ? range.c_str() : nullptr);
+        auto result = curl_easy_perform(curl_);
+        curl_easy_setopt(curl_, CURLOPT_RANGE, nullptr);
+        received += sink.received;
+        sink.out.close();
+        if (result == CURLE_OK && sink.out.fail()) {
+            result = CURLE_WRITE_ERROR;
+        }
+        // Part file already held everything
+        long status = 0;
+        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &status);
+        if (result == CURLE_HTTP_RETURNED_ERROR && status == 416 && sink.offset) {
+            result = CURLE_OK;
+        }
+        return result;
+    });
+    return received;
+}
+
+bool Download::fetch_range(std::u8string const& url, std::uint64_t offset, std::size_t size, std::vector<char>& out) {
+    bt_assert(size != 0);
+    auto unsupported = false;
+    auto const range = fmt::format("{}-{}", offset, offset + size - 1);
+    curl_easy_setopt(curl_, CURLOPT_URL, (char const*)(url.c_str()));
+    curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &RangeSink::write);
+    with_retries(curl_, url, [&] {
+        out.clear();
+        auto sink = RangeSink { curl_, out, size };
+        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &sink);
+        curl_easy_setopt(curl_, CURLOPT_RANGE, range.c_str());
+        auto const result = curl_easy_perform(curl_);
+        curl_easy_setopt(curl_, CURLOPT_RANGE, nullptr);
+        unsupported = sink.unsupported;
+        return unsupported ? CURLE_OK : result;
+    });
+    if (unsupported) {
+        return false;
+    }
+    bt_assert(out.size() == size);
+    return true;
+}
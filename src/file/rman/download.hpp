@@ -0,0 +1,25 @@
+#pragma once
+#include <common/fs.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rman {
+    // Http downloads with bounded retries and backoff, failed transfers continue where they stopped.
+    struct Download {
+        Download();
+        Download(Download const&) = delete;
+        Download& operator=(Download const&) = delete;
+        ~Download();
+
+        // Streams resource into part file, data left there by earlier runs is continued with a range request.
+        // Returns number of bytes received, part file holds whole resource on return.
+        std::uint64_t fetch(std::u8string const& url, fs::path const& part_path);
+
+        // Reads size bytes at offset into out, returns false when server does not serve ranges.
+        bool fetch_range(std::u8string const& url, std::uint64_t offset, std::size_t size, std::vector<char>& out);
+
+    private:
+        void* curl_ = nullptr;
+    };
+}
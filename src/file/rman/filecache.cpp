@@ -0,0 +1,106 @@
+#include <common/binfile.hpp>
+#include <common/bt_error.hpp>
+#include <common/mmap.hpp>
+#include <file/rman/filecache.hpp>
+#include <algorithm>
+
+using namespace rman;
+
+static constexpr auto CACHE_MAGIC = std::array { 'R', 'M', 'F', 'C' };
+static constexpr auto CACHE_VERSION = uint32_t{1};
+
+std::optional<std::vector<FileInfo>> FileCache::read(fs::path const& path, uint64_t manifest_id) {
+    if (!fs::exists(path)) {
+        return std::nullopt;
+    }
+    auto file = MMap<char const>{};
+    if (file.open(path)) {
+        return std::nullopt;
+    }
+    auto reader = BinReader { file.span() };
+    auto magic = std::array<char, 4>{};
+    auto version = uint32_t{};
+    auto id = uint64_t{};
+    if (!reader.read(magic) || magic != CACHE_MAGIC) {
+        return std::nullopt;
+    }
+    if (!reader.read(version) || version != CACHE_VERSION) {
+        return std::nullopt;
+    }
+    if (!reader.read(id) || id != manifest_id) {
+        return std::nullopt;
+    }
+    auto lang_count = uint32_t{};
+    if (!reader.read(lang_count) || lang_count > 64) {
+        return std::nullopt;
+    }
+    auto langs = std::vector<std::u8string>(lang_count);
+    for (auto& lang: langs) {
+        if (!reader.read(lang)) {
+            return std::nullopt;
+        }
+    }
+    auto file_count = uint32_t{};
+    if (!reader.read(file_count)) {
+        return std::nullopt;
+    }
+    auto files = std::vector<FileInfo>{};
+    files.reserve(std::min(file_count, static_cast<uint32_t>(reader.data.size())));
+    for (uint32_t i = 0; i != file_count; ++i) {
+        auto& file_info = files.emplace_back();
+        auto lang_mask = uint64_t{};
+        if (!reader.read(file_info.id)
+            || !reader.read(file_info.size)
+            || !reader.read(file_info.path)
+            || !reader.read(file_info.link)
+            || !reader.read(lang_mask)
+            || !reader.read(file_info.chunks)) {
+            return std::nullopt;
+        }
+        for (uint32_t l = 0; l != lang_count; ++l) {
+            if (lang_mask & (1ull << l)) {
+                file_info.langs.insert(langs[l]);
+            }
+        }
+    }
+    if (!reader.data.empty()) {
+        return std::nullopt;
+    }
+    return files;
+}
+
+void FileCache::write(fs::path const& path, uint64_t manifest_id, std::vector<FileInfo> const& files) {
+    auto langs = std::vector<std::u8string>{};
+    for (auto const& file_info: files) {
+        for (auto const& lang: file_info.langs) {
+            if (std::find(langs.begin(), langs.end(), lang) == langs.end()) {
+                langs.push_back(lang);
+            }
+        }
+    }
+    bt_assert(langs.size() <= 64);
+    auto writer = BinWriter{};
+    writer.write(CACHE_MAGIC);
+    writer.write(CACHE_VERSION);
+    writer.write(manifest_id);
+    writer.write(static_cast<uint32_t>(langs.size()));
+    for (auto const& lang: langs) {
+        writer.write(lang);
+    }
+    writer.write(static_cast<uint32_t>(files.size()));
+    for (auto const& file_info: files) {
+        auto lang_mask = uint64_t{};
+        for (uint32_t l = 0; l != langs.size(); ++l) {
+            if (file_info.langs.contains(langs[l])) {
+                lang_mask |= 1ull << l;
+            }
+        }
+        writer.write(file_info.id);
+        writer.write(file_info.size);
+        writer.write(file_info.path);
+        writer.write(file_info.link);
+        writer.write(lang_mask);
+        writer.write(file_info.chunks);
+    }
+    writer.save(path);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <common/fs.hpp>
+#include <file/rman/manifest.hpp>
+#include <optional>
+
+namespace rman {
+    struct FileCache {
+        static std::optional<std::vector<FileInfo>> read(fs::path const& path, uint64_t manifest_id);
+        static void write(fs::path const& path, uint64_t manifest_id, std::vector<FileInfo> const& files);
+    };
+}
@@ -71,9 +71,27 @@ RMANManifest RMANManifest::read(std::span<char const> data) {
         dir.parent_dir_id = dir_table[1].as<DirID>();
         dir.name = dir_table[2].as<std::u8string>();
     }
+    for (auto const& params_table : body_table[5].as<std::vector<Table>>()) {
+        auto &params = body.params.emplace_back();
+        params.unk0 = params_table[0].as<uint16_t>();
+        params.hash_type = params_table[1].as<HashType>();
+        params.unk2 = params_table[2].as<uint8_t>();
+        params.unk3 = params_table[3].as<uint32_t>();
+        params.max_uncompressed = params_table[4].as<uint32_t>();
+    }
     return body;
 }
 
+uint64_t RMANManifest::read_id(std::span<char const> data) {
+    RMANHeader header;
+    bt_assert(data.size() >= sizeof(RMANHeader));
+    std::memcpy(&header, data.data(), sizeof(RMANHeader));
+    bt_assert(header.magic == std::array { u8'R', u8'M', u8'A', u8'N', });
+    auto id = uint64_t{};
+    std::memcpy(&id, header.checksum.data(), sizeof(id));
+    return id;
+}
+
 std::vector<FileInfo> RMANManifest::list_files() const {
     auto const &manifest = *this;
     auto files = std::vector<FileInfo>{};
@@ -187,12 +205,10 @@ RBUNBundle RBUNBundle::read(std::span<char const> src_data) {
 
 using namespace sha2;
 
+// Pad midstates are hashed once, every hmac round then costs single compression per pad.
 static void RITO_HKDF(uint8_t const* src, size_t size, uint8_t* output) noexcept {
-    auto ctx = SHA256_CTX {};
     auto key = std::array<uint8_t, 64>{};
-    SHA256_Init(&ctx);
-    SHA256_Update(&ctx, src, size);
-    SHA256_Final(key.data(), &ctx);
+    SHA256(src, size, key.data());
     auto ipad = key;
     for (auto& p: ipad) {
         p ^= 0x36u;
@@ -201,26 +217,28 @@ static void RITO_HKDF(uint8_t const* src, size_t size, uint8_t* output) noexcept
     for (auto& p: opad) {
         p ^= 0x5Cu;
     }
+    auto inner = SHA256_CTX {};
+    inner.init();
+    inner.update(ipad.data(), ipad.size());
+    auto outer = SHA256_CTX {};
+    outer.init();
+    outer.update(opad.data(), opad.size());
+    auto const hmac = [&](uint8_t const* data, size_t data_size, uint8_t* hash) {
+        auto ctx = inner;
+        ctx.update(data, data_size);
+        ctx.finish();
+        ctx.digest(hash);
+        ctx = outer;
+        ctx.update(hash, 32);
+        ctx.finish();
+        ctx.digest(hash);
+    };
     auto buffer = std::array<uint8_t, 32> {};
     auto index = std::array<uint8_t, 4>{0x00, 0x00, 0x00, 0x01};
-    SHA256_Init(&ctx);
-    SHA256_Update(&ctx, ipad.data(), ipad.size());
-    SHA256_Update(&ctx, index.data(), index.size());
-    SHA256_Final(buffer.data(), &ctx);
-    SHA256_Init(&ctx);
-    SHA256_Update(&ctx, opad.data(), opad.size());
-    SHA256_Update(&ctx, buffer.data(), buffer.size());
-    SHA256_Final(buffer.data(), &ctx);
+    hmac(index.data(), index.size(), buffer.data());
     auto result = buffer;
     for (uint32_t rounds = 31; rounds; rounds--) {
-        SHA256_Init(&ctx);
-        SHA256_Update(&ctx, ipad.data(), ipad.size());
-        SHA256_Update(&ctx, buffer.data(), buffer.size());
-        SHA256_Final(buffer.data(), &ctx);
-        SHA256_Init(&ctx);
-        SHA256_Update(&ctx, opad.data(), opad.size());
-        SHA256_Update(&ctx, buffer.data(), buffer.size());
-        SHA256_Final(buffer.data(), &ctx);
+        hmac(buffer.data(), buffer.size(), buffer.data());
         for (size_t i = 0; i != 8; ++i) {
             result[i] ^= buffer[i];
         }
@@ -108,6 +108,14 @@ namespace rman {
         std::u8string name;
     };
 
+    struct RMANParams {
+        uint16_t unk0;
+        HashType hash_type;
+        uint8_t unk2;
+        uint32_t unk3;
+        uint32_t max_uncompressed;
+    };
+
     struct FileChunk : RMANChunk {
         BundleID bundle_id;
         uint32_t compressed_offset;
@@ -131,8 +139,10 @@ namespace rman {
         std::vector<RMANLang> langs;
         std::vector<RMANFile> files;
         std::vector<RMANDir> dirs;
+        std::vector<RMANParams> params;
 
         static RMANManifest read(std::span<char const> src_data);
+        static uint64_t read_id(std::span<char const> src_data);
         std::vector<FileInfo> list_files() const;
     };
 }
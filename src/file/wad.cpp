@@ -1,6 +1,10 @@
 #include <common/bt_error.hpp>
 #include <file/hashlist.hpp>
 #include <file/wad.hpp>
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <optional>
 #include <zstd.h>
 #include <zlib.h>
 
@@ -111,14 +115,27 @@ private:
     }
 };
 
+// Entries that point at same payload share one decoded reader while it is alive and its checksums
+struct FileWAD::Alias {
+    std::weak_ptr<Reader> reader = {};
+    std::optional<Checksums> checksums = {};
+    bool checksums_xxh64 = {};
+};
+
 FileWAD::FileWAD(wad::EntryInfo const& info,
                  std::shared_ptr<IReader> source,
                  std::u8string const& source_id,
-                 std::shared_ptr<Location> source_location)
+                 std::shared_ptr<Location> source_location,
+                 std::shared_ptr<WadExtensions> extensions,
+                 std::size_t index,
+                 std::shared_ptr<Alias> alias)
     : info_(info)
     , source_(source)
     , source_id_(source_id)
     , location_(std::make_shared<Location>(source_location, fmt::format(u8"{:016x}", info.path)))
+    , extensions_(extensions)
+    , index_(index)
+    , alias_(alias)
 {}
 
 FileWAD::FileWAD(wad::EntryInfo const& info, std::shared_ptr<IFile> source)
@@ -138,11 +155,17 @@ std::u8string FileWAD::find_extension(HashList& hashes) {
     if (ext.empty()) {
         if (auto link = get_link(); !link.empty()) {
             ext = hashes.find_extension_by_name(link);
+        } else if (extensions_ && !extensions_->list[index_].empty()) {
+            ext = extensions_->list[index_];
         } else {
             auto const reader = open();
             auto const header_size = std::min(info_.size_uncompressed, 32u);
             auto const header_data = reader->read(0, header_size);
             ext = hashes.find_extension_by_data(info_.path, header_data);
+            if (extensions_ && !ext.empty()) {
+                extensions_->list[index_] = ext;
+                extensions_->changed = true;
+            }
         }
     }
     return ext;
@@ -183,12 +206,32 @@ std::u8string FileWAD::id() const {
     }
 }
 
+std::u8string FileWAD::content_id() const {
+    // Checksum covers stored bytes, which decode the same way for same type and sizes
+    if (info_.type == wad::Entry::Type::FileRedirection) {
+        return {};
+    } else if (info_.id) {
+        return fmt::format(u8"{:016x}.{}.{}.{}.sha",
+                           *info_.id, static_cast<int>(info_.type), info_.size_compressed, info_.size_uncompressed);
+    } else if (!source_id_.empty()) {
+        // Without checksum only entries pointing at same place of same wad are known to match
+        return fmt::format(u8"{}.{:x}.{}.{}.{}.xxh", source_id_, info_.offset,
+                           static_cast<int>(info_.type), info_.size_compressed, info_.size_uncompressed);
+    } else {
+        return {};
+    }
+}
+
 std::shared_ptr<Location> FileWAD::location() const {
     return location_;
 }
 
 std::shared_ptr<IReader> FileWAD::open() {
-    if (auto result = reader_.lock()) {
+    auto result = alias_ ? alias_->reader.lock() : nullptr;
+    if (!result) {
+        result = reader_.lock();
+    }
+    if (result) {
         return result;
     } else {
         switch (info_.type) {
@@ -209,6 +252,9 @@ std::shared_ptr<IReader> FileWAD::open() {
             bt_error("Unknown file type!");
             break;
         }
+        if (alias_) {
+            alias_->reader = result;
+        }
         return result;
     }
 }
@@ -217,6 +263,97 @@ bool FileWAD::is_wad() {
     return false;
 }
 
+void FileWAD::stream(std::function<void(std::span<char const>)> const& sink) {
+    static constexpr std::size_t const BLOCK_SIZE = 128 * 1024;
+    // Already decoded payload is cheaper to reuse than to decode again
+    if ((alias_ && !alias_->reader.expired()) || !reader_.expired()) {
+        return IFile::stream(sink);
+    }
+    bt_trace(u8"path hash: {:016X}", info_.path);
+    auto const read_compressed = [this](std::size_t offset) {
+        auto const size = std::min(BLOCK_SIZE, static_cast<std::size_t>(info_.size_compressed) - offset);
+        return source_->read(info_.offset + offset, size);
+    };
+    auto total = std::size_t{};
+    switch (info_.type) {
+    case wad::EntryInfo::Type::FileRedirection:
+        bt_error("Links can't be read!");
+        break;
+    case wad::EntryInfo::Type::Uncompressed:
+        for (std::size_t offset = 0; offset != info_.size_uncompressed;) {
+            auto const size = std::min(BLOCK_SIZE, static_cast<std::size_t>(info_.size_uncompressed) - offset);
+            sink(source_->read(info_.offset + offset, size));
+            offset += size;
+            total += size;
+        }
+        break;
+    case wad::EntryInfo::Type::ZStandardCompressed:
+    case wad::EntryInfo::Type::ZStandardCompressedMultiFrame: {
+        auto const dctx = std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+        auto buffer = std::vector<char>(ZSTD_DStreamOutSize());
+        for (std::size_t offset = 0; offset != info_.size_compressed;) {
+            auto const src = read_compressed(offset);
+            auto input = ZSTD_inBuffer { src.data(), src.size(), 0 };
+            auto output = ZSTD_outBuffer {};
+            do {
+                output = ZSTD_outBuffer { buffer.data(), buffer.size(), 0 };
+                auto const result = ZSTD_decompressStream(dctx.get(), &output, &input);
+                bt_trace("zstd error: {}", ZSTD_getErrorName(result));
+                bt_assert(!ZSTD_isError(result));
+                if (output.pos) {
+                    sink({ buffer.data(), output.pos });
+                    total += output.pos;
+                }
+            } while (input.pos != input.size || output.pos == output.size);
+            offset += src.size();
+        }
+    } break;
+    case wad::EntryInfo::Type::ZlibCompressed: {
+        auto dctx = z_stream_s {};
+        bt_assert(inflateInit2(&dctx, 16 + MAX_WBITS) == Z_OK);
+        auto const guard = std::unique_ptr<z_stream_s, decltype(&inflateEnd)>(&dctx, &inflateEnd);
+        auto buffer = std::vector<char>(BLOCK_SIZE);
+        auto result_zlib = Z_OK;
+        for (std::size_t offset = 0; offset != info_.size_compressed && result_zlib != Z_STREAM_END;) {
+            auto const src = read_compressed(offset);
+            dctx.next_in = reinterpret_cast<unsigned char const*>(src.data());
+            dctx.avail_in = static_cast<unsigned int>(src.size());
+            do {
+                dctx.next_out = reinterpret_cast<unsigned char*>(buffer.data());
+                dctx.avail_out = static_cast<unsigned int>(buffer.size());
+                result_zlib = inflate(&dctx, Z_NO_FLUSH);
+                bt_assert(result_zlib == Z_OK || result_zlib == Z_STREAM_END || result_zlib == Z_BUF_ERROR);
+                auto const produced = buffer.size() - dctx.avail_out;
+                if (produced) {
+                    sink({ buffer.data(), produced });
+                    total += produced;
+                }
+            } while (dctx.avail_out == 0 && result_zlib != Z_STREAM_END);
+            offset += src.size();
+        }
+    } break;
+    default:
+        bt_error("Unknown file type!");
+        break;
+    }
+    bt_assert(total == info_.size_uncompressed);
+}
+
+Checksums FileWAD::checksums(bool with_xxh64) {
+    if (!alias_) {
+        return IFile::checksums(with_xxh64);
+    }
+    if (!alias_->checksums || alias_->checksums_xxh64 != with_xxh64) {
+        alias_->checksums = IFile::checksums(with_xxh64);
+        alias_->checksums_xxh64 = with_xxh64;
+    }
+    return *alias_->checksums;
+}
+
+bool FileWAD::shares_checksums() const {
+    return alias_ != nullptr;
+}
+
 ManagerWAD::ManagerWAD(std::shared_ptr<IFile> source)
     : ManagerWAD(source->open(), source->id(), source->location())
 {}
@@ -232,13 +369,148 @@ ManagerWAD::ManagerWAD(std::shared_ptr<IReader> source,
     auto const header_size = wad.read_header_size(source_->read(0, sizeof(wad::Header)));
     auto const toc_size = wad.read_toc_size(source_->read(0, header_size));
     entries_  = wad.read_entries(source_->read(0, toc_size));
+    extensions_ = std::make_shared<WadExtensions>();
+    extensions_->list.resize(entries_.size());
+    build_sorted();
+    build_aliases();
+}
+
+ManagerWAD::ManagerWAD(std::shared_ptr<IReader> source,
+                       std::u8string const& source_id,
+                       std::shared_ptr<Location> source_location,
+                       std::vector<wad::EntryInfo> entries,
+                       std::shared_ptr<WadExtensions> extensions)
+    : entries_(std::move(entries))
+    , extensions_(std::move(extensions))
+    , source_(source)
+    , location_(source_location)
+    , source_id_(source_id)
+{
+    bt_assert(extensions_ && extensions_->list.size() == entries_.size());
+    build_sorted();
+    build_aliases();
+}
+
+void ManagerWAD::build_sorted() {
+    // Toc is sorted by path hash in practice, only keep lookup order for odd wads
+    auto const compare_path = [](wad::EntryInfo const& lhs, wad::EntryInfo const& rhs) {
+        return lhs.path < rhs.path;
+    };
+    if (std::is_sorted(entries_.begin(), entries_.end(), compare_path)) {
+        sorted_.clear();
+        return;
+    }
+    sorted_.resize(entries_.size());
+    std::iota(sorted_.begin(), sorted_.end(), std::uint32_t{0});
+    std::stable_sort(sorted_.begin(), sorted_.end(), [this](std::uint32_t lhs, std::uint32_t rhs) {
+        return entries_[lhs].path < entries_[rhs].path;
+    });
+}
+
+void ManagerWAD::build_aliases() {
+    using key_t = std::tuple<bool, std::uint64_t, std::uint32_t, std::uint32_t, wad::EntryInfo::Type>;
+    auto groups = std::map<key_t, std::vector<std::size_t>>{};
+    for (std::size_t i = 0; i != entries_.size(); ++i) {
+        auto const& entry = entries_[i];
+        if (entry.type == wad::EntryInfo::Type::FileRedirection) {
+            continue;
+        }
+        // Prefer v3 checksum so duplicated payloads at different offsets are shared too
+        auto const key = entry.id
+            ? key_t { true, *entry.id, entry.size_compressed, entry.size_uncompressed, entry.type }
+            : key_t { false, entry.offset, entry.size_compressed, entry.size_uncompressed, entry.type };
+        groups[key].push_back(i);
+    }
+    aliases_.clear();
+    for (auto const& [key, indices]: groups) {
+        if (indices.size() < 2) {
+            continue;
+        }
+        if (aliases_.empty()) {
+            aliases_.resize(entries_.size());
+        }
+        auto alias = std::make_shared<FileWAD::Alias>();
+        for (auto index: indices) {
+            aliases_[index] = alias;
+        }
+    }
+}
+
+std::shared_ptr<IFile> ManagerWAD::make_file(std::size_t index) {
+    auto const& alias = aliases_.empty() ? nullptr : aliases_[index];
+    return std::make_shared<FileWAD>(entries_[index], source_, source_id_, location_, extensions_, index, alias);
 }
 
 std::vector<std::shared_ptr<IFile>> ManagerWAD::list() {
     auto result = std::vector<std::shared_ptr<IFile>>{};
     result.reserve(entries_.size());
-    for (auto const& entry: entries_) {
-        result.emplace_back(std::make_shared<FileWAD>(entry, source_, source_id_, location_));
+    for (std::size_t i = 0; i != entries_.size(); ++i) {
+        result.emplace_back(make_file(i));
+    }
+    return result;
+}
+
+void ManagerWAD::extract(std::span<ExtractJob const> jobs, [[maybe_unused]] std::size_t threads) {
+    // Aliases of one payload are written one after another while its decoded reader is held, so it is decoded once
+    auto const alias_of = [](ExtractJob const& job) -> FileWAD::Alias const* {
+        auto const file = dynamic_cast<FileWAD const*>(job.file.get());
+        return file ? file->alias() : nullptr;
+    };
+    auto order = std::vector<std::size_t>(jobs.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return std::less<>{}(alias_of(jobs[lhs]), alias_of(jobs[rhs]));
+    });
+    auto held_alias = static_cast<FileWAD::Alias const*>(nullptr);
+    auto held = std::shared_ptr<IReader>{};
+    for (auto index: order) {
+        auto const& job = jobs[index];
+        if (auto const alias = alias_of(job); alias != held_alias) {
+            held_alias = alias;
+            held = alias ? job.file->open() : nullptr;
+        }
+        job.file->extract_to(job.path);
+    }
+}
+
+std::shared_ptr<IFile> ManagerWAD::find(std::uint64_t path) {
+    auto const result = find_many(std::span<std::uint64_t const>(&path, 1));
+    return result.empty() ? nullptr : result.front();
+}
+
+std::vector<std::shared_ptr<IFile>> ManagerWAD::find_many(std::span<std::uint64_t const> paths) {
+    auto sorted_paths = std::vector<std::uint64_t>{};
+    if (!std::is_sorted(paths.begin(), paths.end())) {
+        sorted_paths = { paths.begin(), paths.end() };
+        std::sort(sorted_paths.begin(), sorted_paths.end());
+        paths = sorted_paths;
+    }
+    auto const count = entries_.size();
+    auto const path_at = [this](std::size_t i) -> std::uint64_t {
+        return entries_[sorted_.empty() ? i : sorted_[i]].path;
+    };
+    auto indices = std::vector<std::size_t>{};
+    auto lower = std::size_t{0};
+    for (auto i = paths.begin(); i != paths.end() && lower != count; i = std::upper_bound(i, paths.end(), *i)) {
+        // Binary search within remaining range, queries are sorted so range only shrinks
+        auto upper = count;
+        while (lower < upper) {
+            auto const mid = lower + (upper - lower) / 2;
+            if (path_at(mid) < *i) {
+                lower = mid + 1;
+            } else {
+                upper = mid;
+            }
+        }
+        for (; lower != count && path_at(lower) == *i; ++lower) {
+            indices.push_back(sorted_.empty() ? lower : sorted_[lower]);
+        }
+    }
+    std::sort(indices.begin(), indices.end());
+    auto result = std::vector<std::shared_ptr<IFile>>{};
+    result.reserve(indices.size());
+    for (auto index: indices) {
+        result.emplace_back(make_file(index));
     }
     return result;
 }
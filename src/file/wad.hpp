@@ -3,11 +3,22 @@
 #include <file/wad/wad.hpp>
 
 namespace file {
+    // Extensions sniffed from entry data so far, empty where not sniffed yet, shared with wad index.
+    struct WadExtensions {
+        std::vector<std::u8string> list;
+        bool changed = false;
+    };
+
     struct FileWAD final : IFile {
+        struct Alias;
+
         FileWAD(wad::EntryInfo const& info,
                 std::shared_ptr<IReader> source,
                 std::u8string const& source_id,
-                std::shared_ptr<Location> location);
+                std::shared_ptr<Location> location,
+                std::shared_ptr<WadExtensions> extensions = nullptr,
+                std::size_t index = 0,
+                std::shared_ptr<Alias> alias = nullptr);
         FileWAD(wad::EntryInfo const& info, std::shared_ptr<IFile> source);
 
         std::u8string find_name(HashList& hashes) override;
@@ -16,9 +27,14 @@ namespace file {
         std::u8string get_link() override;
         std::size_t size() const override;
         std::u8string id() const override;
+        std::u8string content_id() const override;
         std::shared_ptr<Location> location() const override;
         std::shared_ptr<IReader> open() override;
         bool is_wad() override;
+        void stream(std::function<void(std::span<char const>)> const& sink) override;
+        Checksums checksums(bool with_xxh64 = false) override;
+        bool shares_checksums() const override;
+        inline Alias const* alias() const noexcept { return alias_.get(); }
 
     private:
         struct Reader;
@@ -32,6 +48,9 @@ namespace file {
         std::u8string link_;
         std::u8string source_id_;
         std::shared_ptr<Location> location_;
+        std::shared_ptr<WadExtensions> extensions_;
+        std::size_t index_;
+        std::shared_ptr<Alias> alias_;
     };
 
     struct ManagerWAD : IManager {
@@ -39,12 +58,29 @@ namespace file {
         ManagerWAD(std::shared_ptr<IReader> source,
                    std::u8string const& source_id,
                    std::shared_ptr<Location> source_location);
+        ManagerWAD(std::shared_ptr<IReader> source,
+                   std::u8string const& source_id,
+                   std::shared_ptr<Location> source_location,
+                   std::vector<wad::EntryInfo> entries,
+                   std::shared_ptr<WadExtensions> extensions);
 
         std::vector<std::shared_ptr<IFile>> list() override;
+        void extract(std::span<ExtractJob const> jobs, std::size_t threads) override;
+        std::shared_ptr<IFile> find(std::uint64_t path);
+        std::vector<std::shared_ptr<IFile>> find_many(std::span<std::uint64_t const> paths);
+        inline std::vector<wad::EntryInfo> const& entries() const noexcept { return entries_; }
+        inline std::shared_ptr<WadExtensions> const& extensions() const noexcept { return extensions_; }
     private:
         std::vector<wad::EntryInfo> entries_;
+        std::shared_ptr<WadExtensions> extensions_;
+        std::vector<std::uint32_t> sorted_;
+        std::vector<std::shared_ptr<FileWAD::Alias>> aliases_;
         std::shared_ptr<IReader> source_;
         std::shared_ptr<Location> location_;
         std::u8string source_id_;
+
+        void build_sorted();
+        void build_aliases();
+        std::shared_ptr<IFile> make_file(std::size_t index);
     };
 }
@@ -35,12 +35,14 @@ std::size_t EntryList::read_toc_size(std::span<char const> src) {
         bt_assert(src.size() >= sizeof(headerV2));
         std::memcpy(&headerV2, src.data(), sizeof(headerV2));
         this->header = headerV2;
+        this->header_checksum = headerV2.checksum;
     } break;
     case 3:{
         HeaderV3 headerV3;
         bt_assert(src.size() >= sizeof(headerV3));
         std::memcpy(&headerV3, src.data(), sizeof(headerV3));
         this->header = headerV3;
+        this->header_checksum = headerV3.checksum;
     } break;
     default:
         bt_error("Unsuported wad version!");
@@ -71,7 +71,9 @@ namespace wad {
         [[nodiscard]] std::size_t read_header_size(std::span<char const> data);
         [[nodiscard]] std::size_t read_toc_size(std::span<char const> data);
         [[nodiscard]] std::vector<EntryInfo> read_entries(std::span<char const> data) const;
+        [[nodiscard]] inline std::array<std::uint8_t, 8> const& checksum() const noexcept { return header_checksum; }
     private:
         HeaderV1 header = {};
+        std::array<std::uint8_t, 8> header_checksum = {};
     };
 }
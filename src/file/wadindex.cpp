@@ -0,0 +1,175 @@
+#include <common/binfile.hpp>
+#include <common/bt_error.hpp>
+#include <common/mmap.hpp>
+#include <file/raw.hpp>
+#include <file/wad.hpp>
+#include <file/wadindex.hpp>
+#include <algorithm>
+
+using namespace file;
+
+static constexpr auto INDEX_MAGIC = std::array { 'W', 'A', 'D', 'I' };
+static constexpr auto INDEX_VERSION = std::uint32_t{3};
+
+static std::array<std::uint8_t, 8> read_checksum(std::shared_ptr<IReader> source) {
+    auto wad = wad::EntryList{};
+    auto const header_size = wad.read_header_size(source->read(0, sizeof(wad::Header)));
+    (void)wad.read_toc_size(source->read(0, header_size));
+    return wad.checksum();
+}
+
+static std::int64_t file_mtime(fs::path const& path) {
+    return static_cast<std::int64_t>(fs::last_write_time(path).time_since_epoch().count());
+}
+
+bool WadIndex::read(fs::path const& path) {
+    if (!fs::exists(path)) {
+        return false;
+    }
+    auto file = MMap<char const>{};
+    if (file.open(path)) {
+        return false;
+    }
+    auto reader = BinReader { file.span() };
+    auto magic = std::array<char, 4>{};
+    auto version = std::uint32_t{};
+    auto record_count = std::uint32_t{};
+    if (!reader.read(magic) || magic != INDEX_MAGIC) {
+        return false;
+    }
+    if (!reader.read(version) || version != INDEX_VERSION) {
+        return false;
+    }
+    if (!reader.read(record_count)) {
+        return false;
+    }
+    auto records = std::unordered_map<std::u8string, Record>{};
+    for (std::uint32_t r = 0; r != record_count; ++r) {
+        auto wad_path = std::u8string{};
+        auto record = Record{};
+        record.extensions = std::make_shared<WadExtensions>();
+        auto entry_count = std::uint32_t{};
+        if (!reader.read(wad_path)
+            || !reader.read(record.size)
+            || !reader.read(record.mtime)
+            || !reader.read(record.checksum)
+            || !reader.read(entry_count)
+            || reader.data.size() / sizeof(wad::Entry) < entry_count) {
+            return false;
+        }
+        record.entries.reserve(entry_count);
+        record.extensions->list.reserve(entry_count);
+        for (std::uint32_t e = 0; e != entry_count; ++e) {
+            auto& entry = record.entries.emplace_back();
+            auto& extension = record.extensions->list.emplace_back();
+            auto has_id = std::uint8_t{};
+            auto id = std::uint64_t{};
+            if (!reader.read(static_cast<wad::Entry&>(entry))
+                || !reader.read(has_id)
+                || !reader.read(id)
+                || !reader.read(extension)) {
+                return false;
+            }
+            if (has_id) {
+                entry.id = id;
+            }
+        }
+        records.insert_or_assign(std::move(wad_path), std::move(record));
+    }
+    records_ = std::move(records);
+    changed_ = false;
+    return true;
+}
+
+void WadIndex::write(fs::path const& path) const {
+    auto const sniffed = std::any_of(records_.begin(), records_.end(), [](auto const& record) {
+        return record.second.extensions->changed;
+    });
+    if (!changed_ && !sniffed) {
+        return;
+    }
+    auto writer = BinWriter{};
+    writer.write(INDEX_MAGIC);
+    writer.write(INDEX_VERSION);
+    writer.write(static_cast<std::uint32_t>(records_.size()));
+    for (auto const& [wad_path, record]: records_) {
+        writer.write(wad_path);
+        writer.write(record.size);
+        writer.write(record.mtime);
+        writer.write(record.checksum);
+        writer.write(static_cast<std::uint32_t>(record.entries.size()));
+        for (std::size_t e = 0; e != record.entries.size(); ++e) {
+            auto const& entry = record.entries[e];
+            writer.write(static_cast<wad::Entry const&>(entry));
+            writer.write(static_cast<std::uint8_t>(entry.id.has_value()));
+            writer.write(entry.id.value_or(0));
+            writer.write(record.extensions->list[e]);
+        }
+    }
+    writer.save(path);
+}
+
+WadIndex::Record const* WadIndex::find_record(FileRAW& source) const {
+    auto const& path = source.path();
+    auto const record = records_.find(path.generic_u8string());
+    if (record == records_.end()) {
+        return nullptr;
+    }
+    auto ec = std::error_code{};
+    auto const size = fs::file_size(path, ec);
+    if (ec || size != record->second.size) {
+        return nullptr;
+    }
+    auto const mtime = fs::last_write_time(path, ec);
+    if (ec || mtime.time_since_epoch().count() != record->second.mtime) {
+        return nullptr;
+    }
+    // Copy tools may keep mtime of rewritten file, header checksum is one small read away
+    if (read_checksum(source.open()) != record->second.checksum) {
+        return nullptr;
+    }
+    return &record->second;
+}
+
+bool WadIndex::contains_any(std::shared_ptr<IFile> source, std::set<std::uint64_t> const& hashes) const {
+    auto const raw = std::dynamic_pointer_cast<FileRAW>(source);
+    if (!raw) {
+        return true;
+    }
+    auto const record = find_record(*raw);
+    if (!record) {
+        return true;
+    }
+    for (auto const& entry: record->entries) {
+        if (hashes.contains(entry.path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<ManagerWAD> WadIndex::open(std::shared_ptr<IFile> source) {
+    auto const raw = std::dynamic_pointer_cast<FileRAW>(source);
+    if (!raw) {
+        return std::make_shared<ManagerWAD>(source);
+    }
+    bt_trace(u8"wad: {}", raw->path().generic_u8string());
+    // Only header is read to validate record, rest of wad is touched once entries are read
+    if (auto const record = find_record(*raw)) {
+        return std::make_shared<ManagerWAD>(source->open(), source->id(), source->location(),
+                                            record->entries, record->extensions);
+    }
+
+    // Index is missing or stale, parse toc once, extensions are sniffed later only when asked for
+    auto result = std::make_shared<ManagerWAD>(source);
+    auto record = Record {
+        static_cast<std::uint64_t>(fs::file_size(raw->path())),
+        file_mtime(raw->path()),
+        read_checksum(source->open()),
+        result->entries(),
+        result->extensions(),
+    };
+    records_.insert_or_assign(raw->path().generic_u8string(), std::move(record));
+    changed_ = true;
+    return result;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <file/base.hpp>
+#include <file/wad/wad.hpp>
+#include <array>
+#include <unordered_map>
+
+namespace file {
+    struct FileRAW;
+    struct ManagerWAD;
+    struct WadExtensions;
+
+    struct WadIndex {
+        // Extensions are filled in as entries get sniffed, so they are only sniffed once across runs
+        struct Record {
+            std::uint64_t size;
+            std::int64_t mtime;
+            std::array<std::uint8_t, 8> checksum;
+            std::vector<wad::EntryInfo> entries;
+            std::shared_ptr<WadExtensions> extensions;
+        };
+
+        bool read(fs::path const& path);
+        void write(fs::path const& path) const;
+
+        // Returns false only when index proves wad contains none of the hashes.
+        bool contains_any(std::shared_ptr<IFile> source, std::set<std::uint64_t> const& hashes) const;
+        std::shared_ptr<ManagerWAD> open(std::shared_ptr<IFile> source);
+    private:
+        std::unordered_map<std::u8string, Record> records_;
+        bool changed_ = false;
+
+        Record const* find_record(FileRAW& source) const;
+    };
+}